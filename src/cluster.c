@@ -0,0 +1,607 @@
+#define REDISMODULE_EXPERIMENTAL_API
+#include "redismodule.h"
+#include "redis-fast-set-ops.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*  The *.CLUSTER variants of the range commands only declare the first key,
+    so under redis cluster the filter key may live on another node. When it
+    isn't found locally, the node owning the source key broadcasts a request
+    for a digest of the filter key over the cluster bus. The owning master
+    answers with the sorted 64 bit hashes of its members, every other master
+    answers that it doesn't have the key, and the range is then computed
+    against the digest here, so only the digest and the partial result cross
+    the network.
+
+    Membership is tested by hash, so in theory a hash collision can make a
+    member appear to be in the filter set. With 64 bit hashes this is
+    vanishingly unlikely for sets of any practical size.
+
+    Building a digest walks and sorts the whole filter key on the owning
+    master's main thread, so the digests it serves are cached until the key
+    changes, and keys with more than ClusterDigestMaxMembers members are
+    refused rather than shipped.
+
+    Since key2 isn't declared under cluster, the server can't apply ACL key
+    patterns to it, so its permissions are checked here before it is read,
+    locally or through a digest. Outside of a cluster both keys are declared
+    through the getkeys API and the server checks them as usual.  */
+
+#define CLUSTER_MSG_DIGEST_REQUEST 1
+#define CLUSTER_MSG_DIGEST_REPLY 2
+
+/* digest replies start with the request id and a status, padded so the
+   hashes that follow stay aligned */
+#define DIGEST_HEADER_LEN 16
+
+#define DIGEST_STATUS_MISSING 0
+#define DIGEST_STATUS_FOUND 1
+#define DIGEST_STATUS_WRONGTYPE 2
+#define DIGEST_STATUS_TOOLARGE 3
+
+/* how long to wait for all masters to answer a digest request */
+#define DIGEST_TIMEOUT_MS 1000
+
+/* past this many cached digests, new ones aren't cached */
+#define DIGEST_CACHE_MAX_KEYS 1024
+
+/* filter keys with more members are refused, 8 bytes each cross the bus */
+long long ClusterDigestMaxMembers = 10000;
+
+/* ACL API of newer servers, looked up at load time since redismodule.h
+   predates it */
+#define ACL_KEY_READ ((1ULL<<0) | (1ULL<<4)) /* CMD_KEY_RO | CMD_KEY_ACCESS */
+static int serverhasacl;
+static RedisModuleString *(*getCurrentUserName)(RedisModuleCtx *);
+static void *(*getModuleUserFromUserName)(RedisModuleString *);
+static int (*aclCheckKeyPermissions)(void *, RedisModuleString *, int);
+static int (*freeModuleUser)(void *);
+
+typedef struct {
+    uint64_t id;
+    RedisModuleBlockedClient *bc;
+    RedisModuleTimerID timer;
+    RedisModuleString *source;
+    ZRangeArgs args;
+    int reverse;
+    int isdiff;
+    int expected;
+    int received;
+    int status;
+    int timedout;
+    uint64_t *digest;
+    size_t digestlen;
+} DigestRequest;
+
+/* a digest served to other nodes, dropped when its key changes */
+typedef struct {
+    uint64_t *hashes;
+    size_t count;
+    int stale;
+    unsigned long long epoch;
+} CachedDigest;
+
+/* pending requests by id, waiting for their digest */
+static RedisModuleDict *pendingrequests = NULL;
+static uint64_t nextrequestid = 0;
+
+/* key name -> CachedDigest */
+static RedisModuleDict *digestcache = NULL;
+
+/* 64 bit FNV-1a, with a final avalanche so all bits are usable */
+static uint64_t hashMember(const char *member, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)member[i];
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static int compareHashes(const void *a, const void *b) {
+    uint64_t ha = *(const uint64_t *)a, hb = *(const uint64_t *)b;
+    return (ha > hb) - (ha < hb);
+}
+
+static void cachedDigestKeyChanged(RedisModuleCtx *ctx,
+                                   void *owner,
+                                   RedisModuleString *key) {
+    CachedDigest *cd = owner;
+    REDISMODULE_NOT_USED(ctx);
+    REDISMODULE_NOT_USED(key);
+
+    // the entry stays tracked, it is refilled by the next request
+    RedisModule_Free(cd->hashes);
+    cd->hashes = NULL;
+    cd->count = 0;
+    cd->stale = 1;
+}
+
+static void cachedDigestMemberChanged(RedisModuleCtx *ctx,
+                                      void *owner,
+                                      RedisModuleString *key,
+                                      RedisModuleString *member) {
+    REDISMODULE_NOT_USED(member);
+    cachedDigestKeyChanged(ctx, owner, key);
+}
+
+static const TrackingCallbacks digestTrackingCallbacks = {
+    cachedDigestMemberChanged,
+    cachedDigestKeyChanged,
+};
+
+/* Fill hashes with the sorted member hashes of zset, returning their
+   count. */
+static size_t buildDigest(RedisModuleCtx *ctx,
+                          RedisModuleKey *zset,
+                          uint64_t *hashes,
+                          size_t count) {
+    size_t i = 0;
+    double score;
+
+    RedisModule_ZsetFirstInScoreRange(zset, REDISMODULE_NEGATIVE_INFINITE,
+                                      REDISMODULE_POSITIVE_INFINITE, 0, 0);
+    while (RedisModule_ZsetRangeEndReached(zset) == 0 && i < count) {
+        size_t elemlen;
+        RedisModuleString *elem =
+            RedisModule_ZsetRangeCurrentElement(zset, &score);
+        const char *member = RedisModule_StringPtrLen(elem, &elemlen);
+
+        hashes[i++] = hashMember(member, elemlen);
+        RedisModule_FreeString(ctx, elem);
+        RedisModule_ZsetRangeNext(zset);
+    }
+    RedisModule_ZsetRangeStop(zset);
+    qsort(hashes, i, sizeof(uint64_t), compareHashes);
+    return i;
+}
+
+/* Return the cached digest of keyname if it is still current. */
+static CachedDigest *lookupCachedDigest(RedisModuleString *keyname) {
+    CachedDigest *cd = RedisModule_DictGet(digestcache, keyname, NULL);
+
+    if (cd == NULL || cd->stale || cd->epoch != TrackingEpoch()) return NULL;
+    return cd;
+}
+
+/* Keep a copy of the digest of keyname until the key changes. Without key
+   tracking we can't tell when that happens, so nothing is cached. */
+static void cacheDigest(RedisModuleCtx *ctx,
+                        RedisModuleString *keyname,
+                        const uint64_t *hashes,
+                        size_t count) {
+    CachedDigest *cd;
+
+    if (!TrackingAvailable()) return;
+
+    cd = RedisModule_DictGet(digestcache, keyname, NULL);
+    if (cd == NULL) {
+        if (RedisModule_DictSize(digestcache) >= DIGEST_CACHE_MAX_KEYS) return;
+        cd = RedisModule_Calloc(1, sizeof(*cd));
+        RedisModule_DictSet(digestcache, keyname, cd);
+        TrackKey(ctx, RedisModule_GetSelectedDb(ctx), keyname,
+                 &digestTrackingCallbacks, cd);
+    }
+
+    RedisModule_Free(cd->hashes);
+    cd->hashes = RedisModule_Alloc(count * sizeof(uint64_t) + 1);
+    memcpy(cd->hashes, hashes, count * sizeof(uint64_t));
+    cd->count = count;
+    cd->stale = 0;
+    cd->epoch = TrackingEpoch();
+}
+
+static int digestContains(const DigestRequest *req, RedisModuleString *elem) {
+    size_t len;
+    const char *member = RedisModule_StringPtrLen(elem, &len);
+    uint64_t h = hashMember(member, len);
+
+    return req->digestlen > 0 &&
+        bsearch(&h, req->digest, req->digestlen, sizeof(h),
+                compareHashes) != NULL;
+}
+
+static void freeDigestRequest(RedisModuleCtx *ctx, void *privdata) {
+    DigestRequest *req = privdata;
+
+    RedisModule_FreeString(ctx, req->source);
+    RedisModule_Free(req->digest);
+    RedisModule_Free(req);
+}
+
+static void finishDigestRequest(RedisModuleCtx *ctx, DigestRequest *req) {
+    RedisModule_DictDelC(pendingrequests, &req->id, sizeof(req->id), NULL);
+    RedisModule_StopTimer(ctx, req->timer, NULL);
+    RedisModule_UnblockClient(req->bc, req);
+}
+
+static void digestRequestTimeout(RedisModuleCtx *ctx, void *data) {
+    DigestRequest *req = data;
+    REDISMODULE_NOT_USED(ctx);
+
+    RedisModule_DictDelC(pendingrequests, &req->id, sizeof(req->id), NULL);
+    req->timedout = 1;
+    RedisModule_UnblockClient(req->bc, req);
+}
+
+/* Runs on the master receiving a digest request: reply with the sorted
+   member hashes of the requested key, or a status if we can't. */
+static void onDigestRequest(RedisModuleCtx *ctx,
+                            const char *sender_id,
+                            uint8_t type,
+                            const unsigned char *payload,
+                            uint32_t len) {
+    char target[REDISMODULE_NODE_ID_LEN];
+    RedisModuleString *keyname;
+    RedisModuleKey *zset;
+    CachedDigest *cd = NULL;
+    unsigned char *msg;
+    size_t count = 0;
+    int status;
+    REDISMODULE_NOT_USED(type);
+
+    // replicas hold the same keys as their master, only masters answer
+    if (len < sizeof(uint64_t) ||
+            !(RedisModule_GetContextFlags(ctx) & REDISMODULE_CTX_FLAGS_MASTER))
+        return;
+
+    keyname = RedisModule_CreateString(ctx, (const char *)payload + 8,
+                                       len - 8);
+    zset = RedisModule_OpenKey(ctx, keyname, REDISMODULE_READ);
+
+    if (zset == NULL) {
+        status = DIGEST_STATUS_MISSING;
+    } else if (RedisModule_KeyType(zset) != REDISMODULE_KEYTYPE_ZSET) {
+        status = DIGEST_STATUS_WRONGTYPE;
+    } else if (RedisModule_ValueLength(zset) >
+                   (size_t)ClusterDigestMaxMembers) {
+        status = DIGEST_STATUS_TOOLARGE;
+    } else {
+        status = DIGEST_STATUS_FOUND;
+        if ((cd = lookupCachedDigest(keyname)) != NULL) {
+            count = cd->count;
+        } else {
+            count = RedisModule_ValueLength(zset);
+        }
+    }
+
+    msg = RedisModule_Calloc(1, DIGEST_HEADER_LEN + count * sizeof(uint64_t));
+    memcpy(msg, payload, 8);
+    msg[8] = status;
+
+    if (cd != NULL) {
+        memcpy(msg + DIGEST_HEADER_LEN, cd->hashes, count * sizeof(uint64_t));
+    } else if (status == DIGEST_STATUS_FOUND) {
+        uint64_t *hashes = (uint64_t *)(msg + DIGEST_HEADER_LEN);
+        count = buildDigest(ctx, zset, hashes, count);
+        cacheDigest(ctx, keyname, hashes, count);
+    }
+
+    memcpy(target, sender_id, REDISMODULE_NODE_ID_LEN);
+    RedisModule_SendClusterMessage(ctx, target, CLUSTER_MSG_DIGEST_REPLY, msg,
+                                   DIGEST_HEADER_LEN +
+                                       count * sizeof(uint64_t));
+
+    RedisModule_Free(msg);
+    RedisModule_CloseKey(zset);
+    RedisModule_FreeString(ctx, keyname);
+}
+
+/* Runs on the node that issued the request: the first master that has the
+   key completes it, otherwise it completes once every master said no. */
+static void onDigestReply(RedisModuleCtx *ctx,
+                          const char *sender_id,
+                          uint8_t type,
+                          const unsigned char *payload,
+                          uint32_t len) {
+    DigestRequest *req;
+    uint64_t id;
+    REDISMODULE_NOT_USED(sender_id);
+    REDISMODULE_NOT_USED(type);
+
+    if (len < DIGEST_HEADER_LEN) return;
+
+    memcpy(&id, payload, sizeof(id));
+    req = RedisModule_DictGetC(pendingrequests, &id, sizeof(id), NULL);
+    // the request may have timed out already
+    if (req == NULL) return;
+
+    req->received++;
+    if (payload[8] != DIGEST_STATUS_MISSING) {
+        req->status = payload[8];
+        req->digestlen = (len - DIGEST_HEADER_LEN) / sizeof(uint64_t);
+        req->digest = RedisModule_Alloc(req->digestlen * sizeof(uint64_t) + 1);
+        memcpy(req->digest, payload + DIGEST_HEADER_LEN,
+               req->digestlen * sizeof(uint64_t));
+        finishDigestRequest(ctx, req);
+    } else if (req->received >= req->expected) {
+        finishDigestRequest(ctx, req);
+    }
+}
+
+/* Reply with the range of the source key filtered by the digest. This is the
+   same loop as zdiffinterrangebyscoreGenericCommand with the membership test
+   swapped for a digest lookup. */
+static int replyWithDigestRange(RedisModuleCtx *ctx, DigestRequest *req) {
+    RedisModuleKey *zset;
+    RedisModuleString *elem;
+    ZRangeArgs *args = &req->args;
+    long long rangelen = 0;
+    double zscore;
+
+    if ((zset = RedisModule_OpenKey(ctx, req->source, REDISMODULE_READ))
+            == NULL) {
+        RedisModule_ReplyWithArray(ctx, 0);
+        return REDISMODULE_OK;
+    }
+    if (RedisModule_KeyType(zset) != REDISMODULE_KEYTYPE_ZSET) {
+        RedisModule_CloseKey(zset);
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+
+    if (req->reverse) {
+        RedisModule_ZsetLastInScoreRange(zset, args->min, args->max,
+                                         args->minex, args->maxex);
+    } else {
+        RedisModule_ZsetFirstInScoreRange(zset, args->min, args->max,
+                                          args->minex, args->maxex);
+    }
+
+    RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+
+    while ((args->limit == -1 || rangelen < args->limit) &&
+            RedisModule_ZsetRangeEndReached(zset) == 0) {
+        elem = RedisModule_ZsetRangeCurrentElement(zset, &zscore);
+        if (digestContains(req, elem) != req->isdiff) {
+            if (args->offset-- <= 0) {
+                RedisModule_ReplyWithString(ctx, elem);
+                if (args->withscores) {
+                    RedisModule_ReplyWithDouble(ctx, zscore);
+                }
+                rangelen++;
+            }
+        }
+
+        RedisModule_FreeString(ctx, elem);
+
+        if (req->reverse) {
+            RedisModule_ZsetRangePrev(zset);
+        } else {
+            RedisModule_ZsetRangeNext(zset);
+        }
+    }
+
+    RedisModule_ReplySetArrayLength(ctx, rangelen * (1 + args->withscores));
+
+    RedisModule_ZsetRangeStop(zset);
+    RedisModule_CloseKey(zset);
+    return REDISMODULE_OK;
+}
+
+static int digestRequestReply(RedisModuleCtx *ctx,
+                              RedisModuleString **argv,
+                              int argc) {
+    DigestRequest *req = RedisModule_GetBlockedClientPrivateData(ctx);
+    REDISMODULE_NOT_USED(argv);
+    REDISMODULE_NOT_USED(argc);
+
+    if (req->timedout) {
+        return RedisModule_ReplyWithError(
+                ctx, "ERR timed out fetching the filter key from the cluster");
+    }
+    if (req->status == DIGEST_STATUS_WRONGTYPE) {
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+    }
+    if (req->status == DIGEST_STATUS_TOOLARGE) {
+        return RedisModule_ReplyWithError(ctx,
+            "ERR the filter key on the other node is too large to fetch");
+    }
+    return replyWithDigestRange(ctx, req);
+}
+
+/* Count the masters other than us that will answer a digest request. */
+static int countOtherMasters(RedisModuleCtx *ctx) {
+    size_t numnodes;
+    char **ids = RedisModule_GetClusterNodesList(ctx, &numnodes);
+    int masters = 0;
+
+    if (ids == NULL) return 0;
+
+    for (size_t i = 0; i < numnodes; i++) {
+        int flags;
+        if (RedisModule_GetClusterNodeInfo(ctx, ids[i], NULL, NULL, NULL,
+                                           &flags) == REDISMODULE_ERR)
+            continue;
+        if ((flags & REDISMODULE_NODE_MASTER) &&
+                !(flags & (REDISMODULE_NODE_MYSELF|REDISMODULE_NODE_FAIL)))
+            masters++;
+    }
+    RedisModule_FreeClusterNodesList(ids);
+    return masters;
+}
+
+/* reply with an error and return REDISMODULE_ERR if the current user may not
+   read the undeclared filter key */
+static int checkFilterKeyAccess(RedisModuleCtx *ctx, RedisModuleString *key) {
+    RedisModuleString *name;
+    void *user;
+    int ok;
+
+    if (!serverhasacl) return REDISMODULE_OK;
+    if (aclCheckKeyPermissions == NULL) {
+        RedisModule_ReplyWithError(ctx,
+            "ERR this server can't check ACL rules for the filter key");
+        return REDISMODULE_ERR;
+    }
+
+    name = getCurrentUserName(ctx);
+    if (name == NULL) return REDISMODULE_OK; /* not run by a client */
+    user = getModuleUserFromUserName(name);
+    RedisModule_FreeString(ctx, name);
+    ok = user != NULL &&
+         aclCheckKeyPermissions(user, key, ACL_KEY_READ) == REDISMODULE_OK;
+    if (user != NULL) freeModuleUser(user);
+    if (!ok) {
+        RedisModule_ReplyWithError(ctx,
+            "NOPERM this user has no permissions to access the filter key");
+        return REDISMODULE_ERR;
+    }
+    return REDISMODULE_OK;
+}
+
+int zdiffinterrangebyscoreClusterGenericCommand(RedisModuleCtx *ctx,
+                                                RedisModuleString **argv,
+                                                int argc,
+                                                int reverse,
+                                                int isdiff) {
+    RedisModuleKey *key;
+    DigestRequest *req;
+    ZRangeArgs args;
+    unsigned char *msg;
+    size_t keylen;
+    const char *keystr;
+    int flags = RedisModule_GetContextFlags(ctx);
+
+    if (RedisModule_IsKeysPositionRequest(ctx)) {
+        if (argc >= 3) {
+            RedisModule_KeyAtPos(ctx, 1);
+            if (!(flags & REDISMODULE_CTX_FLAGS_CLUSTER))
+                RedisModule_KeyAtPos(ctx, 2);
+        }
+        return REDISMODULE_OK;
+    }
+
+    if (argc < 5) return RedisModule_WrongArity(ctx);
+
+    if ((flags & REDISMODULE_CTX_FLAGS_CLUSTER) &&
+            checkFilterKeyAccess(ctx, argv[2]) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    /* Outside of a cluster, or when we have the filter key ourselves, this is
+       just the regular command. */
+    key = RedisModule_OpenKey(ctx, argv[2], REDISMODULE_READ);
+    RedisModule_CloseKey(key);
+    if (!(flags & REDISMODULE_CTX_FLAGS_CLUSTER) || key != NULL) {
+        return zdiffinterrangebyscoreGenericCommand(ctx, argv, argc, reverse,
+                                                    isdiff);
+    }
+
+    if (parseZRangeSuffix(ctx, argv + 5, argc - 5, &args) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+    if (parseZRangeScores(ctx, argv[3], argv[4], reverse, &args)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    /* the digest only holds member hashes, not their scores */
+    if (args.filter != ZRANGE_FILTER_NONE) {
+        RedisModule_ReplyWithError(ctx,
+            "ERR INCLUDEIF/EXCLUDEIF need the filter key on this node");
+        return REDISMODULE_ERR;
+    }
+
+    if (flags & (REDISMODULE_CTX_FLAGS_MULTI|REDISMODULE_CTX_FLAGS_LUA)) {
+        RedisModule_ReplyWithError(ctx,
+            "ERR a filter key on another node can't be used in MULTI or scripts");
+        return REDISMODULE_ERR;
+    }
+
+    req = RedisModule_Calloc(1, sizeof(*req));
+    req->id = nextrequestid++;
+    req->source = RedisModule_CreateStringFromString(ctx, argv[1]);
+    req->args = args;
+    req->reverse = reverse;
+    req->isdiff = isdiff;
+    req->status = DIGEST_STATUS_MISSING;
+    req->expected = countOtherMasters(ctx);
+
+    /* Nobody else could have the filter key, so it doesn't exist. We also
+       skip the round trip when the range is empty or the source is
+       missing, since the filter can't change the result. */
+    key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ);
+    RedisModule_CloseKey(key);
+    if (req->expected == 0 || args.min > args.max || key == NULL) {
+        if (args.min > args.max) {
+            RedisModule_ReplyWithArray(ctx, 0);
+        } else {
+            replyWithDigestRange(ctx, req);
+        }
+        freeDigestRequest(ctx, req);
+        return REDISMODULE_OK;
+    }
+
+    req->bc = RedisModule_BlockClient(ctx, digestRequestReply, NULL,
+                                      freeDigestRequest, 0);
+    req->timer = RedisModule_CreateTimer(ctx, DIGEST_TIMEOUT_MS,
+                                         digestRequestTimeout, req);
+    RedisModule_DictSetC(pendingrequests, &req->id, sizeof(req->id), req);
+
+    keystr = RedisModule_StringPtrLen(argv[2], &keylen);
+    msg = RedisModule_Alloc(8 + keylen);
+    memcpy(msg, &req->id, 8);
+    memcpy(msg + 8, keystr, keylen);
+    RedisModule_SendClusterMessage(ctx, NULL, CLUSTER_MSG_DIGEST_REQUEST,
+                                   msg, 8 + keylen);
+    RedisModule_Free(msg);
+
+    return REDISMODULE_OK;
+}
+
+int ZDiffRangeByScoreCluster_RedisCommand(RedisModuleCtx *ctx,
+                                          RedisModuleString **argv,
+                                          int argc) {
+    return zdiffinterrangebyscoreClusterGenericCommand(ctx, argv, argc, 0, 1);
+}
+
+int ZDiffRevRangeByScoreCluster_RedisCommand(RedisModuleCtx *ctx,
+                                             RedisModuleString **argv,
+                                             int argc) {
+    return zdiffinterrangebyscoreClusterGenericCommand(ctx, argv, argc, 1, 1);
+}
+
+int ZInterRangeByScoreCluster_RedisCommand(RedisModuleCtx *ctx,
+                                           RedisModuleString **argv,
+                                           int argc) {
+    return zdiffinterrangebyscoreClusterGenericCommand(ctx, argv, argc, 0, 0);
+}
+
+int ZInterRevRangeByScoreCluster_RedisCommand(RedisModuleCtx *ctx,
+                                              RedisModuleString **argv,
+                                              int argc) {
+    return zdiffinterrangebyscoreClusterGenericCommand(ctx, argv, argc, 1, 0);
+}
+
+int ClusterInit(RedisModuleCtx *ctx) {
+    void *createuser;
+
+    if (RedisModule_RegisterClusterMessageReceiver == NULL ||
+            RedisModule_BlockClient == NULL ||
+            RedisModule_CreateTimer == NULL)
+        return REDISMODULE_ERR;
+
+    /* servers with ACLs have module users, the key check came later */
+    serverhasacl = RedisModule_GetApi("RedisModule_CreateModuleUser",
+                                      &createuser) == REDISMODULE_OK;
+    if (RedisModule_GetApi("RedisModule_GetCurrentUserName",
+                (void **)&getCurrentUserName) == REDISMODULE_ERR ||
+            RedisModule_GetApi("RedisModule_GetModuleUserFromUserName",
+                (void **)&getModuleUserFromUserName) == REDISMODULE_ERR ||
+            RedisModule_GetApi("RedisModule_ACLCheckKeyPermissions",
+                (void **)&aclCheckKeyPermissions) == REDISMODULE_ERR ||
+            RedisModule_GetApi("RedisModule_FreeModuleUser",
+                (void **)&freeModuleUser) == REDISMODULE_ERR)
+        aclCheckKeyPermissions = NULL;
+
+    pendingrequests = RedisModule_CreateDict(NULL);
+    digestcache = RedisModule_CreateDict(NULL);
+    RedisModule_RegisterClusterMessageReceiver(ctx, CLUSTER_MSG_DIGEST_REQUEST,
+                                               onDigestRequest);
+    RedisModule_RegisterClusterMessageReceiver(ctx, CLUSTER_MSG_DIGEST_REPLY,
+                                               onDigestReply);
+    return REDISMODULE_OK;
+}
@@ -0,0 +1,123 @@
+#include "redismodule.h"
+#include "redis-fast-set-ops.h"
+#include <strings.h>
+
+/*  Prepared queries let clients parse the options of a range command once
+    with FASTSETOPS.PREPARE, and then run it by name with only the keys and
+    the score range through FASTSETOPS.EXEC. Prepared queries are kept per
+    server (not per db), aren't persisted, and under redis cluster have to
+    be prepared on every node.  */
+
+/* past this many prepared queries FASTSETOPS.PREPARE fails */
+#define MAX_PREPARED_QUERIES 1024
+
+typedef struct {
+    int reverse;
+    int isdiff;
+    ZRangeArgs args;
+} PreparedQuery;
+
+static const struct {
+    const char *name;
+    int reverse;
+    int isdiff;
+} preparablecommands[] = {
+    {"zinterrangebyscore", 0, 0},
+    {"zinterrevrangebyscore", 1, 0},
+    {"zdiffrangebyscore", 0, 1},
+    {"zdiffrevrangebyscore", 1, 1},
+};
+
+/* query name -> PreparedQuery */
+static RedisModuleDict *preparedqueries = NULL;
+
+/* FASTSETOPS.PREPARE name command [options ...] */
+int FastSetOpsPrepare_RedisCommand(RedisModuleCtx *ctx,
+                                   RedisModuleString **argv,
+                                   int argc) {
+    const char *cmd;
+    PreparedQuery *q, *old;
+    size_t i, numcommands = sizeof(preparablecommands) /
+                            sizeof(preparablecommands[0]);
+    int nokey;
+
+    if (argc < 3) return RedisModule_WrongArity(ctx);
+
+    cmd = RedisModule_StringPtrLen(argv[2], NULL);
+    for (i = 0; i < numcommands; i++) {
+        if (strcasecmp(cmd, preparablecommands[i].name) == 0) break;
+    }
+    if (i == numcommands) {
+        RedisModule_ReplyWithError(ctx, "ERR command can't be prepared");
+        return REDISMODULE_ERR;
+    }
+
+    q = RedisModule_Alloc(sizeof(*q));
+    q->reverse = preparablecommands[i].reverse;
+    q->isdiff = preparablecommands[i].isdiff;
+    if (parseZRangeSuffix(ctx, argv + 3, argc - 3, &q->args)
+                == REDISMODULE_ERR ||
+            checkZRangeFilter(ctx, &q->args, q->isdiff) == REDISMODULE_ERR) {
+        RedisModule_Free(q);
+        return REDISMODULE_ERR;
+    }
+
+    if (preparedqueries == NULL) preparedqueries = RedisModule_CreateDict(NULL);
+
+    old = RedisModule_DictGet(preparedqueries, argv[1], &nokey);
+    if (nokey && RedisModule_DictSize(preparedqueries) >= MAX_PREPARED_QUERIES) {
+        RedisModule_Free(q);
+        RedisModule_ReplyWithError(ctx, "ERR too many prepared queries");
+        return REDISMODULE_ERR;
+    }
+    RedisModule_DictReplace(preparedqueries, argv[1], q);
+    RedisModule_Free(old);
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+    return REDISMODULE_OK;
+}
+
+/* FASTSETOPS.EXEC name key1 key2 min max */
+int FastSetOpsExec_RedisCommand(RedisModuleCtx *ctx,
+                                RedisModuleString **argv,
+                                int argc) {
+    PreparedQuery *q = NULL;
+    ZRangeArgs args;
+
+    if (argc != 6) return RedisModule_WrongArity(ctx);
+
+    if (preparedqueries != NULL) {
+        q = RedisModule_DictGet(preparedqueries, argv[1], NULL);
+    }
+    if (q == NULL) {
+        RedisModule_ReplyWithError(ctx, "ERR no such prepared query");
+        return REDISMODULE_ERR;
+    }
+
+    args = q->args;
+    if (parseZRangeScores(ctx, argv[4], argv[5], q->reverse, &args)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    return zdiffinterrangebyscoreWithArgs(ctx, argv[2], argv[3], &args,
+                                          q->reverse, q->isdiff);
+}
+
+/* FASTSETOPS.DROP name */
+int FastSetOpsDrop_RedisCommand(RedisModuleCtx *ctx,
+                                RedisModuleString **argv,
+                                int argc) {
+    PreparedQuery *q = NULL;
+
+    if (argc != 2) return RedisModule_WrongArity(ctx);
+
+    if (preparedqueries != NULL &&
+            RedisModule_DictDel(preparedqueries, argv[1], &q)
+                == REDISMODULE_OK) {
+        RedisModule_Free(q);
+        RedisModule_ReplyWithLongLong(ctx, 1);
+    } else {
+        RedisModule_ReplyWithLongLong(ctx, 0);
+    }
+    return REDISMODULE_OK;
+}
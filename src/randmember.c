@@ -0,0 +1,364 @@
+#include "redismodule.h"
+#include "redis-fast-set-ops.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <strings.h>
+
+/*  ZINTERRANDMEMBER and SINTERRANDMEMBER pick random members of the
+    intersection of two keys without computing it. Candidates are drawn
+    from the smaller key and tested against the other, so finding k members
+    takes about k / selectivity tests. When the attempt budget runs out
+    before k members are found, the rest are picked with a reservoir sample
+    over a full scan of the smaller key, which keeps the result uniform over
+    the intersection.  */
+
+/* attempts allowed per requested member when MAXATTEMPTS isn't given */
+#define RANDMEMBER_ATTEMPTS_PER_MEMBER 10
+
+/* without MAXATTEMPTS, asking for more than this fraction of the smaller key
+   skips sampling and scans it right away */
+#define RANDMEMBER_SCAN_FRACTION 4
+
+/* k members picked so far; slots from base on are filled by the reservoir
+   scan, those before it by sampling */
+typedef struct {
+    RedisModuleString **members;
+    double *scores;
+    RedisModuleDict *picked;
+    long long size, cap, base;
+    long long seen;
+} Reservoir;
+
+static long long randomIndex(long long n) {
+    uint64_t r = ((uint64_t)rand() << 31) ^ (uint64_t)rand();
+    return (long long)(r % (uint64_t)n);
+}
+
+static void reservoirInit(Reservoir *r, long long cap) {
+    r->members = RedisModule_Alloc(sizeof(*r->members) * (cap ? cap : 1));
+    r->scores = RedisModule_Alloc(sizeof(*r->scores) * (cap ? cap : 1));
+    r->picked = RedisModule_CreateDict(NULL);
+    r->size = 0;
+    r->cap = cap;
+    r->base = 0;
+    r->seen = 0;
+}
+
+static void reservoirFree(RedisModuleCtx *ctx, Reservoir *r) {
+    for (long long i = 0; i < r->size; i++) {
+        RedisModule_FreeString(ctx, r->members[i]);
+    }
+    RedisModule_Free(r->members);
+    RedisModule_Free(r->scores);
+    RedisModule_FreeDict(NULL, r->picked);
+}
+
+/* Offer a member to the reservoir, which takes ownership of it. */
+static void reservoirOffer(RedisModuleCtx *ctx,
+                           Reservoir *r,
+                           RedisModuleString *member,
+                           double score) {
+    long long j;
+
+    r->seen++;
+    if (r->size < r->cap) {
+        RedisModule_DictSet(r->picked, member, NULL);
+        r->members[r->size] = member;
+        r->scores[r->size++] = score;
+        return;
+    }
+
+    j = randomIndex(r->seen);
+    if (j < r->cap - r->base) {
+        RedisModule_DictDel(r->picked, r->members[r->base + j], NULL);
+        RedisModule_DictSet(r->picked, member, NULL);
+        RedisModule_FreeString(ctx, r->members[r->base + j]);
+        r->members[r->base + j] = member;
+        r->scores[r->base + j] = score;
+    } else {
+        RedisModule_FreeString(ctx, member);
+    }
+}
+
+static int reservoirContains(Reservoir *r, RedisModuleString *member) {
+    int nokey;
+    RedisModule_DictGet(r->picked, member, &nokey);
+    return !nokey;
+}
+
+static void replyWithReservoir(RedisModuleCtx *ctx,
+                               Reservoir *r,
+                               int withscores) {
+    RedisModule_ReplyWithArray(ctx, r->size * (1 + withscores));
+    for (long long i = 0; i < r->size; i++) {
+        RedisModule_ReplyWithString(ctx, r->members[i]);
+        if (withscores) RedisModule_ReplyWithDouble(ctx, r->scores[i]);
+    }
+}
+
+/* Parse the k [WITHSCORES] [MAXATTEMPTS attempts] arguments. maxattempts is
+   left at -1 when not given. On failure an error is replied and
+   REDISMODULE_ERR is returned. */
+static int parseRandMemberArgs(RedisModuleCtx *ctx,
+                               RedisModuleString **argv,
+                               int argc,
+                               int allowscores,
+                               long long *count,
+                               int *withscores,
+                               long long *maxattempts) {
+    *withscores = 0;
+    *maxattempts = -1;
+
+    if (RedisModule_StringToLongLong(argv[0], count) == REDISMODULE_ERR ||
+            *count < 0) {
+        RedisModule_ReplyWithError(ctx,
+                                   "ERR count is not a non negative integer");
+        return REDISMODULE_ERR;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = RedisModule_StringPtrLen(argv[i], NULL);
+
+        if (allowscores && strcasecmp(opt, "withscores") == 0) {
+            *withscores = 1;
+        } else if (i + 1 < argc && strcasecmp(opt, "maxattempts") == 0) {
+            if (RedisModule_StringToLongLong(argv[++i], maxattempts)
+                    == REDISMODULE_ERR || *maxattempts < 0) {
+                RedisModule_ReplyWithError(ctx,
+                    "ERR maxattempts is not a non negative integer");
+                return REDISMODULE_ERR;
+            }
+        } else {
+            RedisModule_WrongArity(ctx);
+            return REDISMODULE_ERR;
+        }
+    }
+    return REDISMODULE_OK;
+}
+
+/* Open key as a key of the given type, replying with an error if it holds
+   another type. A missing key is returned as NULL. */
+static int openTypedKey(RedisModuleCtx *ctx,
+                        RedisModuleString *keyname,
+                        int type,
+                        RedisModuleKey **key) {
+    *key = RedisModule_OpenKey(ctx, keyname, REDISMODULE_READ);
+    if (*key != NULL && RedisModule_KeyType(*key) != type) {
+        RedisModule_CloseKey(*key);
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+    return REDISMODULE_OK;
+}
+
+/* The attempts made when MAXATTEMPTS isn't given: never more draws than the
+   smaller key has members, and none when the scan would be about as cheap. */
+static long long defaultAttempts(long long count, long long len) {
+    if (count * RANDMEMBER_SCAN_FRACTION >= len) return 0;
+    if (count * RANDMEMBER_ATTEMPTS_PER_MEMBER > len) return len;
+    return count * RANDMEMBER_ATTEMPTS_PER_MEMBER;
+}
+
+int ZInterRandMember_RedisCommand(RedisModuleCtx *ctx,
+                                  RedisModuleString **argv,
+                                  int argc) {
+    RedisModuleKey *key1, *key2, *sample, *other;
+    RedisModuleString *samplename, *elem;
+    RedisModuleCallReply *reply;
+    Reservoir res;
+    long long count, maxattempts, len;
+    int withscores;
+    double score, otherscore;
+
+    if (argc < 4) return RedisModule_WrongArity(ctx);
+
+    if (parseRandMemberArgs(ctx, argv + 3, argc - 3, 1, &count, &withscores,
+                            &maxattempts) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (openTypedKey(ctx, argv[1], REDISMODULE_KEYTYPE_ZSET, &key1)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+    if (openTypedKey(ctx, argv[2], REDISMODULE_KEYTYPE_ZSET, &key2)
+            == REDISMODULE_ERR) {
+        RedisModule_CloseKey(key1);
+        return REDISMODULE_ERR;
+    }
+
+    if (key1 == NULL || key2 == NULL || count == 0) {
+        RedisModule_CloseKey(key1);
+        RedisModule_CloseKey(key2);
+        RedisModule_ReplyWithArray(ctx, 0);
+        return REDISMODULE_OK;
+    }
+
+    if (RedisModule_ValueLength(key1) <= RedisModule_ValueLength(key2)) {
+        sample = key1;
+        samplename = argv[1];
+        other = key2;
+    } else {
+        sample = key2;
+        samplename = argv[2];
+        other = key1;
+    }
+    len = RedisModule_ValueLength(sample);
+    if (count > len) count = len;
+    if (maxattempts == -1) maxattempts = defaultAttempts(count, len);
+
+    reservoirInit(&res, count);
+
+    /* sample ranks of the smaller key, scores always come from key1 */
+    for (long long i = 0; i < maxattempts && res.size < count; i++) {
+        long long rank = randomIndex(len);
+
+        reply = RedisModule_Call(ctx, "ZRANGE", "sll", samplename, rank, rank);
+        if (RedisModule_CallReplyType(reply) != REDISMODULE_REPLY_ARRAY ||
+                RedisModule_CallReplyLength(reply) != 1) {
+            RedisModule_FreeCallReply(reply);
+            continue;
+        }
+        elem = RedisModule_CreateStringFromCallReply(
+                RedisModule_CallReplyArrayElement(reply, 0));
+        RedisModule_FreeCallReply(reply);
+
+        if (RedisModule_ZsetScore(key1, elem, &score) == REDISMODULE_OK &&
+                RedisModule_ZsetScore(key2, elem, &otherscore)
+                    == REDISMODULE_OK &&
+                !reservoirContains(&res, elem)) {
+            reservoirOffer(ctx, &res, elem, score);
+        } else {
+            RedisModule_FreeString(ctx, elem);
+        }
+    }
+
+    /* out of attempts, pick the rest from a scan of the smaller key */
+    if (res.size < count) {
+        res.base = res.size;
+        res.seen = 0;
+        RedisModule_ZsetFirstInScoreRange(sample, -INFINITY, INFINITY, 0, 0);
+        while (RedisModule_ZsetRangeEndReached(sample) == 0) {
+            elem = RedisModule_ZsetRangeCurrentElement(sample, &score);
+            if (RedisModule_ZsetScore(other, elem, &otherscore)
+                        == REDISMODULE_OK &&
+                    !reservoirContains(&res, elem)) {
+                if (sample != key1) score = otherscore;
+                reservoirOffer(ctx, &res, elem, score);
+            } else {
+                RedisModule_FreeString(ctx, elem);
+            }
+            RedisModule_ZsetRangeNext(sample);
+        }
+        RedisModule_ZsetRangeStop(sample);
+    }
+
+    replyWithReservoir(ctx, &res, withscores);
+
+    reservoirFree(ctx, &res);
+    RedisModule_CloseKey(key1);
+    RedisModule_CloseKey(key2);
+    return REDISMODULE_OK;
+}
+
+static int isSetMember(RedisModuleCtx *ctx,
+                       RedisModuleString *key,
+                       RedisModuleString *member) {
+    RedisModuleCallReply *reply = RedisModule_Call(ctx, "SISMEMBER", "ss",
+                                                   key, member);
+    int found = RedisModule_CallReplyInteger(reply) == 1;
+
+    RedisModule_FreeCallReply(reply);
+    return found;
+}
+
+/* Offer every member of the array reply that is also in the set at other to
+   the reservoir. */
+static void offerSetMembers(RedisModuleCtx *ctx,
+                            Reservoir *res,
+                            RedisModuleCallReply *reply,
+                            RedisModuleString *other) {
+    size_t len = RedisModule_CallReplyLength(reply);
+
+    for (size_t i = 0; i < len; i++) {
+        RedisModuleString *elem = RedisModule_CreateStringFromCallReply(
+                RedisModule_CallReplyArrayElement(reply, i));
+
+        if (isSetMember(ctx, other, elem)) {
+            reservoirOffer(ctx, res, elem, 0);
+        } else {
+            RedisModule_FreeString(ctx, elem);
+        }
+    }
+}
+
+int SInterRandMember_RedisCommand(RedisModuleCtx *ctx,
+                                  RedisModuleString **argv,
+                                  int argc) {
+    RedisModuleKey *key1, *key2;
+    RedisModuleString *samplename, *othername;
+    RedisModuleCallReply *reply;
+    Reservoir res;
+    long long count, maxattempts, len;
+    int withscores;
+
+    if (argc < 4) return RedisModule_WrongArity(ctx);
+
+    if (parseRandMemberArgs(ctx, argv + 3, argc - 3, 0, &count, &withscores,
+                            &maxattempts) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (openTypedKey(ctx, argv[1], REDISMODULE_KEYTYPE_SET, &key1)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+    if (openTypedKey(ctx, argv[2], REDISMODULE_KEYTYPE_SET, &key2)
+            == REDISMODULE_ERR) {
+        RedisModule_CloseKey(key1);
+        return REDISMODULE_ERR;
+    }
+
+    if (key1 == NULL || key2 == NULL || count == 0) {
+        RedisModule_CloseKey(key1);
+        RedisModule_CloseKey(key2);
+        RedisModule_ReplyWithArray(ctx, 0);
+        return REDISMODULE_OK;
+    }
+
+    if (RedisModule_ValueLength(key1) <= RedisModule_ValueLength(key2)) {
+        samplename = argv[1];
+        othername = argv[2];
+    } else {
+        samplename = argv[2];
+        othername = argv[1];
+    }
+    len = RedisModule_ValueLength(samplename == argv[1] ? key1 : key2);
+    RedisModule_CloseKey(key1);
+    RedisModule_CloseKey(key2);
+
+    if (count > len) count = len;
+    if (maxattempts == -1) maxattempts = defaultAttempts(count, len);
+
+    reservoirInit(&res, count);
+
+    /* SRANDMEMBER with a positive count gives distinct candidates, but not
+       in random order, so the hits go through the reservoir too */
+    if (maxattempts > 0) {
+        reply = RedisModule_Call(ctx, "SRANDMEMBER", "sl", samplename,
+                                 maxattempts < len ? maxattempts : len);
+        offerSetMembers(ctx, &res, reply, othername);
+        RedisModule_FreeCallReply(reply);
+    }
+
+    /* unless the candidates covered the whole smaller set, too few hits
+       means starting over with a scan of all of it */
+    if (res.size < count && maxattempts < len) {
+        reservoirFree(ctx, &res);
+        reservoirInit(&res, count);
+        reply = RedisModule_Call(ctx, "SMEMBERS", "s", samplename);
+        offerSetMembers(ctx, &res, reply, othername);
+        RedisModule_FreeCallReply(reply);
+    }
+
+    replyWithReservoir(ctx, &res, 0);
+    reservoirFree(ctx, &res);
+    return REDISMODULE_OK;
+}
@@ -1,10 +1,42 @@
+#define REDISMODULE_EXPERIMENTAL_API
 #include "redismodule.h"
 #include "redis-fast-set-ops.h"
+#include <strings.h>
+
+/* Parse the module arguments, given as option name and value pairs. */
+static int parseModuleArgs(RedisModuleCtx *ctx,
+                           RedisModuleString **argv,
+                           int argc) {
+    for (int i = 0; i < argc; i += 2) {
+        const char *opt = RedisModule_StringPtrLen(argv[i], NULL);
+        long long value;
+
+        if (i + 1 == argc ||
+                RedisModule_StringToLongLong(argv[i + 1], &value)
+                    == REDISMODULE_ERR || value < 0) {
+            RedisModule_Log(ctx, "warning",
+                            "module option %s needs a non negative integer",
+                            opt);
+            return REDISMODULE_ERR;
+        }
+
+        if (strcasecmp(opt, "cluster-digest-max-members") == 0) {
+            ClusterDigestMaxMembers = value;
+        } else {
+            RedisModule_Log(ctx, "warning", "unknown module option %s", opt);
+            return REDISMODULE_ERR;
+        }
+    }
+    return REDISMODULE_OK;
+}
 
 int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc) {
     if (RedisModule_Init(ctx,"redis-fast-set-ops",1,REDISMODULE_APIVER_1) == REDISMODULE_ERR)
 		return REDISMODULE_ERR;
 
+    if (parseModuleArgs(ctx, argv, argc) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
     if (RedisModule_CreateCommand(ctx, "zdiffrangebyscore",
                                   ZDiffRangeByScore_RedisCommand,
                                   "readonly",1,2,1)
@@ -29,6 +61,58 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
             == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
+    if (RedisModule_CreateCommand(ctx, "zintercard.grouped",
+                                  ZInterCardGrouped_RedisCommand,
+                                  "readonly getkeys-api",1,1,1)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    /* the cluster variants only declare the source key, so the filter key
+       may hash to a slot on another node */
+    if (ClusterInit(ctx) == REDISMODULE_OK) {
+        if (RedisModule_CreateCommand(ctx, "zdiffrangebyscore.cluster",
+                                      ZDiffRangeByScoreCluster_RedisCommand,
+                                      "readonly getkeys-api",1,1,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+
+        if (RedisModule_CreateCommand(ctx, "zdiffrevrangebyscore.cluster",
+                                      ZDiffRevRangeByScoreCluster_RedisCommand,
+                                      "readonly getkeys-api",1,1,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+
+        if (RedisModule_CreateCommand(ctx, "zinterrangebyscore.cluster",
+                                      ZInterRangeByScoreCluster_RedisCommand,
+                                      "readonly getkeys-api",1,1,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+
+        if (RedisModule_CreateCommand(ctx, "zinterrevrangebyscore.cluster",
+                                      ZInterRevRangeByScoreCluster_RedisCommand,
+                                      "readonly getkeys-api",1,1,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+    }
+
+    if (RedisModule_CreateCommand(ctx, "fastsetops.prepare",
+                                  FastSetOpsPrepare_RedisCommand,
+                                  "readonly fast",0,0,0)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "fastsetops.exec",
+                                  FastSetOpsExec_RedisCommand,
+                                  "readonly",2,-3,1)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "fastsetops.drop",
+                                  FastSetOpsDrop_RedisCommand,
+                                  "readonly fast",0,0,0)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
     if (RedisModule_CreateCommand(ctx, "sintercard",
                                   SInterCard_RedisCommand,
                                   "readonly",1,-1,1)
@@ -47,6 +131,75 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
             == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
+    if (RedisModule_CreateCommand(ctx, "sintercard.matrix",
+                                  SInterCardMatrix_RedisCommand,
+                                  "readonly",1,-1,1)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "sjaccard.matrix",
+                                  SJaccardMatrix_RedisCommand,
+                                  "readonly",1,-1,1)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "zinterrandmember",
+                                  ZInterRandMember_RedisCommand,
+                                  "readonly random",1,2,1)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "sinterrandmember",
+                                  SInterRandMember_RedisCommand,
+                                  "readonly random",1,2,1)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (ZInterViewInit(ctx) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    /* views and indexes depend on keyspace notifications and command
+       filters, which older servers don't provide */
+    if (TrackingInit(ctx) == REDISMODULE_OK) {
+        if (RedisModule_CreateCommand(ctx, "zinterindex.create",
+                                      ZInterIndexCreate_RedisCommand,
+                                      "readonly deny-oom",1,2,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+
+        if (RedisModule_CreateCommand(ctx, "zinterindex.drop",
+                                      ZInterIndexDrop_RedisCommand,
+                                      "readonly fast",1,2,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+
+        if (RedisModule_CreateCommand(ctx, "zinterview.create",
+                                      ZInterViewCreate_RedisCommand,
+                                      "write deny-oom",1,-1,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+
+        if (RedisModule_CreateCommand(ctx, "zinterview.rangebyscore",
+                                      ZInterViewRangeByScore_RedisCommand,
+                                      "readonly",1,1,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+
+        if (RedisModule_CreateCommand(ctx, "zinterview.revrangebyscore",
+                                      ZInterViewRevRangeByScore_RedisCommand,
+                                      "readonly",1,1,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+
+        if (RedisModule_CreateCommand(ctx, "zinterview.card",
+                                      ZInterViewCard_RedisCommand,
+                                      "readonly fast",1,1,1)
+                == REDISMODULE_ERR)
+            return REDISMODULE_ERR;
+    } else {
+        RedisModule_Log(ctx, "warning",
+                        "key tracking unavailable, ZINTERVIEW and ZINTERINDEX disabled");
+    }
 
     return REDISMODULE_OK;
 }
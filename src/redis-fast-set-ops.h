@@ -1,10 +1,95 @@
 #include "redismodule.h"
 
+#define ZRANGE_FILTER_NONE 0
+#define ZRANGE_FILTER_INCLUDEIF 1
+#define ZRANGE_FILTER_EXCLUDEIF 2
+
+/* score range and reply modifiers shared by the *RANGEBYSCORE commands */
+typedef struct {
+    double min, max;
+    int minex, maxex;
+    int withscores;
+    long long offset;
+    long long limit;
+    /* INCLUDEIF/EXCLUDEIF window on the score of the second key */
+    int filter;
+    double filtermin, filtermax;
+    int filterminex, filtermaxex;
+} ZRangeArgs;
+
+int parseZRangeScores(RedisModuleCtx *, RedisModuleString *, RedisModuleString *, int, ZRangeArgs *);
+int parseZRangeSuffix(RedisModuleCtx *, RedisModuleString **, int, ZRangeArgs *);
+
+/* callbacks invoked by the key tracking layer when a tracked key changes,
+   either for a single member (member_changed) or in a way that can't be
+   expressed as member deltas (key_changed) */
+typedef struct {
+    void (*member_changed)(RedisModuleCtx *, void *, RedisModuleString *, RedisModuleString *);
+    void (*key_changed)(RedisModuleCtx *, void *, RedisModuleString *);
+} TrackingCallbacks;
+
+int TrackingInit(RedisModuleCtx *);
+int TrackingAvailable(void);
+void TrackingOnCommand(void (*)(void));
+unsigned long long TrackingEpoch(void);
+void TrackKey(RedisModuleCtx *, int, RedisModuleString *, const TrackingCallbacks *, void *);
+void UntrackKey(int, RedisModuleString *, void *);
+
+/* score bucket index over the intersection of two sorted sets, iterated as
+   the sub-ranges of a score range that can hold intersecting members */
+typedef struct ZInterIndex ZInterIndex;
+
+typedef struct {
+    ZInterIndex *idx;
+    RedisModuleDictIter *iter;
+    const ZRangeArgs *range;
+    long long first, last;
+    int reverse;
+} ZInterIndexIter;
+
+ZInterIndex *GetZInterIndex(RedisModuleCtx *, RedisModuleString *, RedisModuleString *);
+void ZInterIndexIterStart(ZInterIndexIter *, ZInterIndex *, const ZRangeArgs *, int);
+int ZInterIndexIterNext(ZInterIndexIter *, ZRangeArgs *);
+void ZInterIndexIterStop(ZInterIndexIter *);
+
+int ZInterViewInit(RedisModuleCtx *);
+int ClusterInit(RedisModuleCtx *);
+
+/* filter keys with more members aren't sent to other cluster nodes */
+extern long long ClusterDigestMaxMembers;
+
+int checkZRangeFilter(RedisModuleCtx *, const ZRangeArgs *, int);
+int zdiffinterrangebyscoreWithArgs(RedisModuleCtx *, RedisModuleString *, RedisModuleString *, const ZRangeArgs *, int, int);
+int zdiffinterrangebyscoreGenericCommand(RedisModuleCtx *, RedisModuleString **, int, int, int);
+
 int ZDiffRangeByScore_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **, int);
 int ZDiffRevRangeByScore_RedisCommand(RedisModuleCtx *ctx, RedisModuleString **, int);
 int ZInterRangeByScore_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
 int ZInterRevRangeByScore_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int ZInterCardGrouped_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+
+int ZDiffRangeByScoreCluster_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int ZDiffRevRangeByScoreCluster_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int ZInterRangeByScoreCluster_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int ZInterRevRangeByScoreCluster_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+
+int ZInterIndexCreate_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int ZInterIndexDrop_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+
+int ZInterViewCreate_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int ZInterViewRangeByScore_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int ZInterViewRevRangeByScore_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int ZInterViewCard_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
 
 int SDiffCard_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
 int SInterCard_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
 int SUnionCard_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int SInterCardMatrix_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int SJaccardMatrix_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+
+int FastSetOpsPrepare_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int FastSetOpsExec_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int FastSetOpsDrop_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+
+int ZInterRandMember_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
+int SInterRandMember_RedisCommand(RedisModuleCtx *, RedisModuleString **, int);
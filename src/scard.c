@@ -1,9 +1,14 @@
 #include "redismodule.h"
+#include <stdint.h>
+#include <string.h>
 
 #define SET_COMMAND_DIFF 0
 #define SET_COMMAND_INTER 1
 #define SET_COMMAND_UNION 2
 
+/* the matrix commands keep and reply numsets * numsets counts */
+#define MATRIX_MAX_KEYS 1024
+
 int SDiffInterUnionCard_GenericCommand(RedisModuleCtx *ctx,
                                        RedisModuleString **argv,
                                        int argc,
@@ -49,3 +54,117 @@ int SUnionCard_RedisCommand(RedisModuleCtx *ctx,
                             int argc) {
     return SDiffInterUnionCard_GenericCommand(ctx, argv, argc, SET_COMMAND_UNION);
 }
+
+/* Reply with the pairwise intersection cardinalities of all given sets, or
+   their Jaccard similarity if jaccard is set. Each set is read once into an
+   index from member to a bitmask of the sets containing it, and every member
+   then adds one to the count of each pair of sets in its mask. */
+int SInterCardMatrix_GenericCommand(RedisModuleCtx *ctx,
+                                    RedisModuleString **argv,
+                                    int argc,
+                                    int jaccard) {
+    RedisModuleDict *members;
+    RedisModuleDictIter *iter;
+    RedisModuleCallReply *reply;
+    long long *counts;
+    int *setbits;
+    uint64_t *mask;
+    size_t numsets, words;
+    int err = 0;
+
+    if (argc < 2) return RedisModule_WrongArity(ctx);
+
+    numsets = argc - 1;
+    if (numsets > MATRIX_MAX_KEYS) {
+        RedisModule_ReplyWithError(ctx,
+            "ERR too many keys, at most 1024 are supported");
+        return REDISMODULE_ERR;
+    }
+    words = (numsets + 63) / 64;
+    counts = RedisModule_Calloc(numsets * numsets, sizeof(*counts));
+    setbits = RedisModule_Alloc(numsets * sizeof(*setbits));
+    members = RedisModule_CreateDict(NULL);
+
+    for (size_t i = 0; i < numsets; i++) {
+        reply = RedisModule_Call(ctx, "SMEMBERS", "s", argv[i + 1]);
+
+        if (RedisModule_CallReplyType(reply) == REDISMODULE_REPLY_ERROR) {
+            RedisModule_ReplyWithCallReply(ctx, reply);
+            RedisModule_FreeCallReply(reply);
+            err = 1;
+            break;
+        }
+
+        size_t card = RedisModule_CallReplyLength(reply);
+        counts[i * numsets + i] = card;
+        for (size_t j = 0; j < card; j++) {
+            size_t len;
+            const char *member = RedisModule_CallReplyStringPtr(
+                    RedisModule_CallReplyArrayElement(reply, j), &len);
+
+            mask = RedisModule_DictGetC(members, (void *)member, len, NULL);
+            if (mask == NULL) {
+                mask = RedisModule_Calloc(words, sizeof(*mask));
+                RedisModule_DictSetC(members, (void *)member, len, mask);
+            }
+            mask[i / 64] |= 1ULL << (i % 64);
+        }
+        RedisModule_FreeCallReply(reply);
+    }
+
+    iter = RedisModule_DictIteratorStartC(members, "^", NULL, 0);
+    while (RedisModule_DictNextC(iter, NULL, (void **)&mask) != NULL) {
+        size_t numbits = 0;
+
+        for (size_t w = 0; w < words && !err; w++) {
+            uint64_t bits = mask[w];
+            while (bits) {
+                setbits[numbits++] = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+            }
+        }
+        for (size_t a = 0; a < numbits; a++) {
+            for (size_t b = a + 1; b < numbits; b++) {
+                counts[setbits[a] * numsets + setbits[b]]++;
+            }
+        }
+        RedisModule_Free(mask);
+    }
+    RedisModule_DictIteratorStop(iter);
+    RedisModule_FreeDict(NULL, members);
+
+    if (!err) {
+        RedisModule_ReplyWithArray(ctx, numsets);
+        for (size_t i = 0; i < numsets; i++) {
+            RedisModule_ReplyWithArray(ctx, numsets);
+            for (size_t j = 0; j < numsets; j++) {
+                long long inter = i <= j ? counts[i * numsets + j]
+                                         : counts[j * numsets + i];
+                if (jaccard) {
+                    long long uni = counts[i * numsets + i] +
+                        counts[j * numsets + j] - inter;
+                    RedisModule_ReplyWithDouble(ctx, uni ? (double)inter / uni
+                                                         : 0);
+                } else {
+                    RedisModule_ReplyWithLongLong(ctx, inter);
+                }
+            }
+        }
+    }
+
+    RedisModule_Free(setbits);
+    RedisModule_Free(counts);
+    return err ? REDISMODULE_ERR : REDISMODULE_OK;
+}
+
+int SInterCardMatrix_RedisCommand(RedisModuleCtx *ctx,
+                                  RedisModuleString **argv,
+                                  int argc) {
+    return SInterCardMatrix_GenericCommand(ctx, argv, argc, 0);
+}
+
+int SJaccardMatrix_RedisCommand(RedisModuleCtx *ctx,
+                                RedisModuleString **argv,
+                                int argc) {
+    return SInterCardMatrix_GenericCommand(ctx, argv, argc, 1);
+}
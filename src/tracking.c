@@ -0,0 +1,325 @@
+#define REDISMODULE_EXPERIMENTAL_API
+#include "redismodule.h"
+#include "redis-fast-set-ops.h"
+#include <string.h>
+#include <strings.h>
+
+/*  Key tracking lets derived structures (like ZINTERVIEW views) follow
+    changes to the sorted sets they were computed from without rescanning
+    them. Keyspace notifications tell us which key changed but not which
+    members, so a command filter records the members named by ZADD, ZINCRBY
+    and ZREM on tracked keys, and the matching notification (which only
+    fires once the write has actually happened) replays them as member
+    deltas. Any other event on a tracked key is reported as a change of the
+    whole key.
+
+    Members recorded by a command that turns out to change nothing (like a
+    ZADD with an unchanged score) stay pending since no notification fires,
+    so pending members are only replayed for the event of the command that
+    recorded them, and any other command naming the key first makes its next
+    event a change of the whole key. Events that don't change members, like
+    EXPIRE, are ignored.
+
+    FLUSHDB, FLUSHALL, SWAPDB and MOVE change keys without any per key
+    notification, and so does loading a dataset, as DEBUG RELOAD does or a
+    full resync after REPLICAOF or a cluster failover. These commands just
+    bump the tracking epoch and listeners compare it against the epoch they
+    were built at. The epoch is bumped when the
+    filter sees the command, so a flush queued in MULTI can still be missed
+    by a listener rebuilt before the EXEC.
+
+    The keyspace subscription and the command filter see every command and
+    write on the server, so they are only installed once the first key is
+    tracked.   */
+
+/* past this many buffered members for one key we stop recording and report
+   the whole key as changed instead */
+#define TRACKING_MAX_PENDING 4096
+
+typedef struct {
+    int dbid;
+    const TrackingCallbacks *cb;
+    void *owner;
+} TrackingListener;
+
+typedef struct {
+    TrackingListener *listeners;
+    size_t numlisteners;
+    RedisModuleString **pending;
+    size_t numpending;
+    const char *pendingevent;   /* event expected for the pending members */
+    int overflow;
+} TrackedKey;
+
+/* tracked key name -> TrackedKey, shared by all dbs */
+static RedisModuleDict *trackedkeys = NULL;
+static unsigned long long trackingepoch = 0;
+static int trackinginstalled = 0;
+static void (*oncommand)(void) = NULL;
+
+/* Call fn on the main thread before every command while keys are tracked. */
+void TrackingOnCommand(void (*fn)(void)) {
+    oncommand = fn;
+}
+
+/* Whether keys can be tracked on this server. */
+int TrackingAvailable(void) {
+    return trackedkeys != NULL;
+}
+
+unsigned long long TrackingEpoch(void) {
+    return trackingepoch;
+}
+
+static TrackedKey *lookupTrackedKey(const RedisModuleString *key) {
+    size_t keylen;
+    const char *keystr = RedisModule_StringPtrLen(key, &keylen);
+    return RedisModule_DictGetC(trackedkeys, (void *)keystr, keylen, NULL);
+}
+
+static void clearPending(TrackedKey *tk) {
+    for (size_t i = 0; i < tk->numpending; i++) {
+        RedisModule_FreeString(NULL, tk->pending[i]);
+    }
+    tk->numpending = 0;
+    tk->pendingevent = NULL;
+    tk->overflow = 0;
+}
+
+/* Give up on member deltas until the next event on the key, which is then
+   reported as a change of the whole key. */
+static void setOverflow(TrackedKey *tk) {
+    clearPending(tk);
+    tk->overflow = 1;
+}
+
+static void addPending(TrackedKey *tk,
+                       const char *event,
+                       const RedisModuleString *member) {
+    if (tk->overflow) return;
+    if (tk->pendingevent != NULL && strcmp(tk->pendingevent, event) != 0) {
+        setOverflow(tk);
+        return;
+    }
+    tk->pendingevent = event;
+    if (tk->numpending == TRACKING_MAX_PENDING) {
+        setOverflow(tk);
+        return;
+    }
+    if (tk->pending == NULL) {
+        tk->pending = RedisModule_Alloc(sizeof(*tk->pending) *
+                                        TRACKING_MAX_PENDING);
+    }
+    tk->pending[tk->numpending++] =
+        RedisModule_CreateStringFromString(NULL, member);
+}
+
+static void trackingInstall(RedisModuleCtx *ctx);
+
+void TrackKey(RedisModuleCtx *ctx,
+              int dbid,
+              RedisModuleString *key,
+              const TrackingCallbacks *cb,
+              void *owner) {
+    size_t keylen;
+    const char *keystr = RedisModule_StringPtrLen(key, &keylen);
+    TrackedKey *tk = RedisModule_DictGetC(trackedkeys, (void *)keystr,
+                                          keylen, NULL);
+
+    if (!trackinginstalled) trackingInstall(ctx);
+
+    if (tk == NULL) {
+        tk = RedisModule_Calloc(1, sizeof(*tk));
+        RedisModule_DictSetC(trackedkeys, (void *)keystr, keylen, tk);
+    }
+
+    tk->listeners = RedisModule_Realloc(
+            tk->listeners, sizeof(*tk->listeners) * (tk->numlisteners + 1));
+    tk->listeners[tk->numlisteners].dbid = dbid;
+    tk->listeners[tk->numlisteners].cb = cb;
+    tk->listeners[tk->numlisteners].owner = owner;
+    tk->numlisteners++;
+}
+
+void UntrackKey(int dbid, RedisModuleString *key, void *owner) {
+    size_t keylen;
+    const char *keystr = RedisModule_StringPtrLen(key, &keylen);
+    TrackedKey *tk = RedisModule_DictGetC(trackedkeys, (void *)keystr,
+                                          keylen, NULL);
+
+    if (tk == NULL) return;
+
+    for (size_t i = 0; i < tk->numlisteners; i++) {
+        if (tk->listeners[i].dbid == dbid && tk->listeners[i].owner == owner) {
+            tk->listeners[i] = tk->listeners[--tk->numlisteners];
+            break;
+        }
+    }
+
+    if (tk->numlisteners == 0) {
+        RedisModule_DictDelC(trackedkeys, (void *)keystr, keylen, NULL);
+        clearPending(tk);
+        RedisModule_Free(tk->pending);
+        RedisModule_Free(tk->listeners);
+        RedisModule_Free(tk);
+    }
+}
+
+/* Whether cmd never changes the members of its key. */
+static int keepsMembers(const char *cmd) {
+    return strcasecmp(cmd, "expire") == 0 || strcasecmp(cmd, "pexpire") == 0 ||
+        strcasecmp(cmd, "expireat") == 0 || strcasecmp(cmd, "pexpireat") == 0 ||
+        strcasecmp(cmd, "persist") == 0;
+}
+
+/* Whether the command replaces keys without notifying each of them. */
+static int changesKeysSilently(RedisModuleCommandFilterCtx *fctx,
+                               const char *cmd,
+                               int argc) {
+    const char *sub;
+
+    if (strcasecmp(cmd, "flushdb") == 0 || strcasecmp(cmd, "flushall") == 0 ||
+            strcasecmp(cmd, "swapdb") == 0 || strcasecmp(cmd, "move") == 0 ||
+            strcasecmp(cmd, "replicaof") == 0 ||
+            strcasecmp(cmd, "slaveof") == 0)
+        return 1;
+    if (argc < 2) return 0;
+
+    sub = RedisModule_StringPtrLen(RedisModule_CommandFilterArgGet(fctx, 1),
+                                   NULL);
+    if (strcasecmp(cmd, "debug") == 0)
+        return strcasecmp(sub, "reload") == 0 ||
+            strcasecmp(sub, "loadaof") == 0;
+    if (strcasecmp(cmd, "cluster") == 0)
+        return strcasecmp(sub, "failover") == 0 ||
+            strcasecmp(sub, "replicate") == 0 ||
+            strcasecmp(sub, "reset") == 0;
+    return 0;
+}
+
+/* Record the members a ZADD/ZINCRBY/ZREM on a tracked key is about to touch.
+   The command may still fail, but replaying a member that didn't change is
+   harmless since listeners re-evaluate it from the current key contents. */
+static void trackingCommandFilter(RedisModuleCommandFilterCtx *fctx) {
+    int argc, first, step;
+    const char *cmd, *event;
+    TrackedKey *tk;
+
+    if (RedisModule_DictSize(trackedkeys) == 0) return;
+    if (oncommand != NULL) oncommand();
+
+    argc = RedisModule_CommandFilterArgsCount(fctx);
+    cmd = RedisModule_StringPtrLen(
+            RedisModule_CommandFilterArgGet(fctx, 0), NULL);
+
+    if (changesKeysSilently(fctx, cmd, argc)) {
+        trackingepoch++;
+        return;
+    }
+
+    if (argc < 2 ||
+            (tk = lookupTrackedKey(RedisModule_CommandFilterArgGet(fctx, 1)))
+                == NULL)
+        return;
+
+    if (argc >= 3 && strcasecmp(cmd, "zadd") == 0) {
+        // skip the flags, members follow their scores
+        first = 2;
+        event = "zadd";
+        while (first < argc) {
+            const char *opt = RedisModule_StringPtrLen(
+                    RedisModule_CommandFilterArgGet(fctx, first), NULL);
+            if (strcasecmp(opt, "incr") == 0) {
+                event = "zincr";   // ZADD INCR fires the ZINCRBY event
+            } else if (strcasecmp(opt, "nx") && strcasecmp(opt, "xx") &&
+                    strcasecmp(opt, "ch") && strcasecmp(opt, "gt") &&
+                    strcasecmp(opt, "lt")) {
+                break;
+            }
+            first++;
+        }
+        first++;
+        step = 2;
+    } else if (argc >= 3 && strcasecmp(cmd, "zincrby") == 0) {
+        first = 3;
+        step = 1;
+        event = "zincr";
+    } else if (argc >= 3 && strcasecmp(cmd, "zrem") == 0) {
+        first = 2;
+        step = 1;
+        event = "zrem";
+    } else {
+        /* Members left pending by a command that changed nothing could be
+           taken for the delta of this one (GEOADD fires "zadd" too), so
+           whatever this command does is reported as a whole key change.
+           Without pending members there is nothing to mistake. */
+        if (tk->numpending > 0 && !keepsMembers(cmd)) setOverflow(tk);
+        return;
+    }
+
+    for (int i = first; i < argc; i += step) {
+        addPending(tk, event, RedisModule_CommandFilterArgGet(fctx, i));
+    }
+}
+
+static int trackingKeyspaceNotification(RedisModuleCtx *ctx,
+                                        int type,
+                                        const char *event,
+                                        RedisModuleString *key) {
+    TrackedKey *tk;
+    int dbid, isdelta;
+    REDISMODULE_NOT_USED(type);
+
+    if ((tk = lookupTrackedKey(key)) == NULL) return REDISMODULE_OK;
+
+    /* the members are untouched, leave anything pending for the event of
+       the command that recorded it */
+    if (strcmp(event, "expire") == 0 || strcmp(event, "persist") == 0)
+        return REDISMODULE_OK;
+
+    dbid = RedisModule_GetSelectedDb(ctx);
+    isdelta = !tk->overflow && tk->numpending > 0 &&
+        strcmp(event, tk->pendingevent) == 0;
+
+    for (size_t i = 0; i < tk->numlisteners; i++) {
+        TrackingListener *l = &tk->listeners[i];
+        if (l->dbid != dbid) continue;
+
+        if (isdelta) {
+            for (size_t j = 0; j < tk->numpending; j++) {
+                l->cb->member_changed(ctx, l->owner, key, tk->pending[j]);
+            }
+        } else {
+            l->cb->key_changed(ctx, l->owner, key);
+        }
+    }
+
+    clearPending(tk);
+    return REDISMODULE_OK;
+}
+
+/* Start following keyspace events and commands. There is no way to
+   unsubscribe, so once installed they stay, but return right away while no
+   key is tracked. */
+static void trackingInstall(RedisModuleCtx *ctx) {
+    if (RedisModule_SubscribeToKeyspaceEvents(ctx, REDISMODULE_NOTIFY_ALL,
+                                              trackingKeyspaceNotification)
+                == REDISMODULE_ERR ||
+            RedisModule_RegisterCommandFilter(ctx, trackingCommandFilter, 0)
+                == NULL) {
+        RedisModule_Log(ctx, "warning", "failed to install key tracking");
+        return;
+    }
+    trackinginstalled = 1;
+}
+
+int TrackingInit(RedisModuleCtx *ctx) {
+    REDISMODULE_NOT_USED(ctx);
+
+    if (RedisModule_SubscribeToKeyspaceEvents == NULL ||
+            RedisModule_RegisterCommandFilter == NULL)
+        return REDISMODULE_ERR;
+
+    trackedkeys = RedisModule_CreateDict(NULL);
+    return REDISMODULE_OK;
+}
@@ -0,0 +1,446 @@
+#define REDISMODULE_EXPERIMENTAL_API
+#include "redismodule.h"
+#include "redis-fast-set-ops.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/*  A ZINTERINDEX summarizes where the intersection of two sorted sets lies
+    along the score axis of the first: scores are cut into buckets of a
+    fixed width and the index counts the intersecting members per bucket.
+    ZINTERRANGEBYSCORE consults it to only scan the buckets of key1 that hold
+    at least one member of key2, so sparse intersections over long ranges
+    cost a lookup per non-empty bucket instead of a probe per element.
+
+    Only non-empty buckets are stored, along with the bucket of each
+    intersecting member so the counts can be updated when that member
+    changes. Indexes are maintained through the key tracking layer like
+    ZINTERVIEW, but live outside the keyspace and aren't persisted.
+
+    A replica's dataset can be replaced by a full resync without any command
+    the tracking layer sees, so indexes can't be created on replicas, and
+    the ones created while the server was a master are ignored and marked
+    stale while it is a replica.  */
+
+/* bucket numbers are clamped so bucket bounds stay exact doubles, with the
+   outermost buckets extending to the infinities */
+#define BUCKET_MIN (-(1LL << 52))
+#define BUCKET_MAX (1LL << 52)
+
+struct ZInterIndex {
+    int dbid;
+    RedisModuleString *key1;
+    RedisModuleString *key2;
+    double width;
+    RedisModuleDict *buckets; // sortable bucket -> long long *count
+    RedisModuleDict *members; // member -> long long *bucket
+    unsigned long long epoch;
+    int stale;
+};
+
+/* (dbid, key1, key2) -> ZInterIndex */
+static RedisModuleDict *indexes = NULL;
+
+static unsigned char *indexName(int dbid,
+                                RedisModuleString *key1,
+                                RedisModuleString *key2,
+                                size_t *namelen) {
+    size_t len1, len2;
+    const char *str1 = RedisModule_StringPtrLen(key1, &len1);
+    const char *str2 = RedisModule_StringPtrLen(key2, &len2);
+    unsigned char *name = RedisModule_Alloc(sizeof(dbid) + sizeof(len1) +
+                                            len1 + len2);
+    unsigned char *p = name;
+
+    memcpy(p, &dbid, sizeof(dbid));
+    p += sizeof(dbid);
+    memcpy(p, &len1, sizeof(len1));
+    p += sizeof(len1);
+    memcpy(p, str1, len1);
+    memcpy(p + len1, str2, len2);
+    *namelen = sizeof(dbid) + sizeof(len1) + len1 + len2;
+    return name;
+}
+
+static double bucketLow(const ZInterIndex *idx, long long bucket) {
+    if (bucket <= BUCKET_MIN) return REDISMODULE_NEGATIVE_INFINITE;
+    if (bucket > BUCKET_MAX) return REDISMODULE_POSITIVE_INFINITE;
+    return bucket * idx->width;
+}
+
+/* The bucket holding score, settled against bucketLow so a member is always
+   found by scanning its bucket's bounds despite rounding in the division. */
+static long long scoreBucket(const ZInterIndex *idx, double score) {
+    double q = floor(score / idx->width);
+    long long bucket;
+
+    if (q <= BUCKET_MIN) {
+        bucket = BUCKET_MIN;
+    } else if (q >= BUCKET_MAX) {
+        bucket = BUCKET_MAX;
+    } else {
+        bucket = (long long)q;
+    }
+    while (bucket > BUCKET_MIN && score < bucketLow(idx, bucket)) bucket--;
+    while (bucket < BUCKET_MAX && score >= bucketLow(idx, bucket + 1)) bucket++;
+    return bucket;
+}
+
+static void putBucket(unsigned char *buf, long long bucket) {
+    uint64_t bits = (uint64_t)bucket ^ 0x8000000000000000ULL;
+    for (int i = 7; i >= 0; i--) {
+        buf[i] = bits & 0xff;
+        bits >>= 8;
+    }
+}
+
+static long long getBucket(const unsigned char *buf) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) {
+        bits = (bits << 8) | buf[i];
+    }
+    return (long long)(bits ^ 0x8000000000000000ULL);
+}
+
+static void bucketAdd(ZInterIndex *idx, long long bucket, int delta) {
+    unsigned char key[8];
+    long long *count;
+
+    putBucket(key, bucket);
+    count = RedisModule_DictGetC(idx->buckets, key, sizeof(key), NULL);
+    if (count == NULL) {
+        count = RedisModule_Calloc(1, sizeof(*count));
+        RedisModule_DictSetC(idx->buckets, key, sizeof(key), count);
+    }
+
+    *count += delta;
+    if (*count == 0) {
+        RedisModule_DictDelC(idx->buckets, key, sizeof(key), NULL);
+        RedisModule_Free(count);
+    }
+}
+
+static void indexSetMember(ZInterIndex *idx,
+                           const char *member,
+                           size_t len,
+                           int present,
+                           double score) {
+    long long *bucket = RedisModule_DictGetC(idx->members, (void *)member,
+                                             len, NULL);
+    long long newbucket = present ? scoreBucket(idx, score) : 0;
+
+    if (bucket != NULL) {
+        if (present && *bucket == newbucket) return;
+        bucketAdd(idx, *bucket, -1);
+        if (!present) {
+            RedisModule_DictDelC(idx->members, (void *)member, len, NULL);
+            RedisModule_Free(bucket);
+            return;
+        }
+    } else {
+        if (!present) return;
+        bucket = RedisModule_Alloc(sizeof(*bucket));
+        RedisModule_DictSetC(idx->members, (void *)member, len, bucket);
+    }
+
+    *bucket = newbucket;
+    bucketAdd(idx, newbucket, 1);
+}
+
+static void freeDictValues(RedisModuleDict *d) {
+    RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(d, "^", NULL, 0);
+    void *value;
+
+    while (RedisModule_DictNextC(iter, NULL, &value) != NULL) {
+        RedisModule_Free(value);
+    }
+    RedisModule_DictIteratorStop(iter);
+    RedisModule_FreeDict(NULL, d);
+}
+
+static void indexClear(ZInterIndex *idx) {
+    if (idx->members != NULL) {
+        freeDictValues(idx->members);
+        freeDictValues(idx->buckets);
+    }
+    idx->members = RedisModule_CreateDict(NULL);
+    idx->buckets = RedisModule_CreateDict(NULL);
+}
+
+static RedisModuleKey *openZset(RedisModuleCtx *ctx, RedisModuleString *name) {
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, name, REDISMODULE_READ);
+
+    if (key != NULL && RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_ZSET) {
+        RedisModule_CloseKey(key);
+        return NULL;
+    }
+    return key;
+}
+
+/* Recompute the index by scanning the smaller key and probing the other. */
+static void indexRebuild(RedisModuleCtx *ctx, ZInterIndex *idx) {
+    RedisModuleKey *zset1, *zset2, *scan, *probe;
+    RedisModuleString *elem;
+    double score, probescore;
+
+    indexClear(idx);
+    idx->stale = 0;
+    idx->epoch = TrackingEpoch();
+
+    zset1 = openZset(ctx, idx->key1);
+    zset2 = openZset(ctx, idx->key2);
+    if (zset1 == NULL || zset2 == NULL) {
+        RedisModule_CloseKey(zset1);
+        RedisModule_CloseKey(zset2);
+        return;
+    }
+
+    if (RedisModule_ValueLength(zset2) < RedisModule_ValueLength(zset1)) {
+        scan = zset2;
+        probe = zset1;
+    } else {
+        scan = zset1;
+        probe = zset2;
+    }
+
+    RedisModule_ZsetFirstInScoreRange(scan, REDISMODULE_NEGATIVE_INFINITE,
+                                      REDISMODULE_POSITIVE_INFINITE, 0, 0);
+    while (RedisModule_ZsetRangeEndReached(scan) == 0) {
+        elem = RedisModule_ZsetRangeCurrentElement(scan, &score);
+        if (RedisModule_ZsetScore(probe, elem, &probescore) == REDISMODULE_OK) {
+            size_t len;
+            const char *member = RedisModule_StringPtrLen(elem, &len);
+            indexSetMember(idx, member, len, 1,
+                           scan == zset1 ? score : probescore);
+        }
+        RedisModule_FreeString(ctx, elem);
+        RedisModule_ZsetRangeNext(scan);
+    }
+    RedisModule_ZsetRangeStop(scan);
+
+    RedisModule_CloseKey(zset1);
+    RedisModule_CloseKey(zset2);
+}
+
+static void indexMemberChanged(RedisModuleCtx *ctx,
+                               void *owner,
+                               RedisModuleString *key,
+                               RedisModuleString *member) {
+    ZInterIndex *idx = owner;
+    RedisModuleKey *zset1, *zset2;
+    double score = 0, probescore;
+    size_t len;
+    const char *memberstr = RedisModule_StringPtrLen(member, &len);
+    int present;
+    REDISMODULE_NOT_USED(key);
+
+    if (idx->stale) return;
+
+    zset1 = openZset(ctx, idx->key1);
+    zset2 = openZset(ctx, idx->key2);
+    present = zset1 != NULL && zset2 != NULL &&
+        RedisModule_ZsetScore(zset1, member, &score) == REDISMODULE_OK &&
+        RedisModule_ZsetScore(zset2, member, &probescore) == REDISMODULE_OK;
+    indexSetMember(idx, memberstr, len, present, score);
+
+    RedisModule_CloseKey(zset1);
+    RedisModule_CloseKey(zset2);
+}
+
+static void indexKeyChanged(RedisModuleCtx *ctx,
+                            void *owner,
+                            RedisModuleString *key) {
+    ZInterIndex *idx = owner;
+    REDISMODULE_NOT_USED(ctx);
+    REDISMODULE_NOT_USED(key);
+
+    idx->stale = 1;
+}
+
+static const TrackingCallbacks indexTrackingCallbacks = {
+    indexMemberChanged,
+    indexKeyChanged
+};
+
+static void indexFree(ZInterIndex *idx) {
+    UntrackKey(idx->dbid, idx->key1, idx);
+    UntrackKey(idx->dbid, idx->key2, idx);
+    freeDictValues(idx->members);
+    freeDictValues(idx->buckets);
+    RedisModule_FreeString(NULL, idx->key1);
+    RedisModule_FreeString(NULL, idx->key2);
+    RedisModule_Free(idx);
+}
+
+/* Remove the index for the given keys, returning whether there was one. */
+static int indexDrop(int dbid,
+                     RedisModuleString *key1,
+                     RedisModuleString *key2) {
+    size_t namelen;
+    unsigned char *name = indexName(dbid, key1, key2, &namelen);
+    ZInterIndex *idx = RedisModule_DictGetC(indexes, name, namelen, NULL);
+
+    if (idx != NULL) {
+        RedisModule_DictDelC(indexes, name, namelen, NULL);
+        indexFree(idx);
+    }
+    RedisModule_Free(name);
+    return idx != NULL;
+}
+
+ZInterIndex *GetZInterIndex(RedisModuleCtx *ctx,
+                            RedisModuleString *key1,
+                            RedisModuleString *key2) {
+    ZInterIndex *idx;
+    unsigned char *name;
+    size_t namelen;
+
+    if (indexes == NULL || RedisModule_DictSize(indexes) == 0) return NULL;
+
+    if (RedisModule_GetContextFlags(ctx) & REDISMODULE_CTX_FLAGS_SLAVE) {
+        RedisModuleDictIter *iter = RedisModule_DictIteratorStartC(
+                indexes, "^", NULL, 0);
+        while (RedisModule_DictNextC(iter, NULL, (void **)&idx) != NULL)
+            idx->stale = 1;
+        RedisModule_DictIteratorStop(iter);
+        return NULL;
+    }
+
+    name = indexName(RedisModule_GetSelectedDb(ctx), key1, key2, &namelen);
+    idx = RedisModule_DictGetC(indexes, name, namelen, NULL);
+    RedisModule_Free(name);
+
+    if (idx != NULL && (idx->stale || idx->epoch != TrackingEpoch()))
+        indexRebuild(ctx, idx);
+    return idx;
+}
+
+void ZInterIndexIterStart(ZInterIndexIter *it,
+                          ZInterIndex *idx,
+                          const ZRangeArgs *range,
+                          int reverse) {
+    unsigned char key[8];
+
+    it->idx = idx;
+    it->range = range;
+    it->reverse = reverse;
+    it->first = scoreBucket(idx, range->min);
+    it->last = scoreBucket(idx, range->max);
+
+    if (reverse) {
+        putBucket(key, it->last);
+        it->iter = RedisModule_DictIteratorStartC(idx->buckets, "<=", key,
+                                                  sizeof(key));
+    } else {
+        putBucket(key, it->first);
+        it->iter = RedisModule_DictIteratorStartC(idx->buckets, ">=", key,
+                                                  sizeof(key));
+    }
+}
+
+/* Fill segment with the part of the range covered by the next non-empty
+   bucket, returning 0 once there are no more. */
+int ZInterIndexIterNext(ZInterIndexIter *it, ZRangeArgs *segment) {
+    const ZRangeArgs *range = it->range;
+    unsigned char *key;
+    long long bucket;
+    double low, high;
+
+    if (it->reverse) {
+        key = RedisModule_DictPrevC(it->iter, NULL, NULL);
+    } else {
+        key = RedisModule_DictNextC(it->iter, NULL, NULL);
+    }
+    if (key == NULL) return 0;
+
+    bucket = getBucket(key);
+    if (bucket < it->first || bucket > it->last) return 0;
+
+    low = bucketLow(it->idx, bucket);
+    if (low > range->min) {
+        segment->min = low;
+        segment->minex = 0;
+    } else {
+        segment->min = range->min;
+        segment->minex = range->minex;
+    }
+
+    high = bucketLow(it->idx, bucket + 1);
+    if (bucket < BUCKET_MAX && high <= range->max) {
+        segment->max = high;
+        segment->maxex = 1;
+    } else {
+        segment->max = range->max;
+        segment->maxex = range->maxex;
+    }
+    return 1;
+}
+
+void ZInterIndexIterStop(ZInterIndexIter *it) {
+    RedisModule_DictIteratorStop(it->iter);
+}
+
+int ZInterIndexCreate_RedisCommand(RedisModuleCtx *ctx,
+                                   RedisModuleString **argv,
+                                   int argc) {
+    RedisModuleKey *key;
+    ZInterIndex *idx;
+    unsigned char *name;
+    size_t namelen;
+    double width;
+    int dbid = RedisModule_GetSelectedDb(ctx);
+
+    if (argc != 4) return RedisModule_WrongArity(ctx);
+
+    if (RedisModule_GetContextFlags(ctx) & REDISMODULE_CTX_FLAGS_SLAVE) {
+        RedisModule_ReplyWithError(ctx,
+            "ERR indexes can't be created on a replica");
+        return REDISMODULE_ERR;
+    }
+
+    if (RedisModule_StringToDouble(argv[3], &width) == REDISMODULE_ERR ||
+            !(width > 0) || isinf(width)) {
+        RedisModule_ReplyWithError(ctx, "ERR width must be a positive number");
+        return REDISMODULE_ERR;
+    }
+
+    for (int i = 1; i <= 2; i++) {
+        if ((key = RedisModule_OpenKey(ctx, argv[i], REDISMODULE_READ)) != NULL
+                && RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_ZSET) {
+            RedisModule_CloseKey(key);
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+            return REDISMODULE_ERR;
+        }
+        RedisModule_CloseKey(key);
+    }
+
+    if (indexes == NULL) indexes = RedisModule_CreateDict(NULL);
+    indexDrop(dbid, argv[1], argv[2]);
+
+    idx = RedisModule_Calloc(1, sizeof(*idx));
+    idx->dbid = dbid;
+    idx->key1 = RedisModule_CreateStringFromString(NULL, argv[1]);
+    idx->key2 = RedisModule_CreateStringFromString(NULL, argv[2]);
+    idx->width = width;
+    indexRebuild(ctx, idx);
+
+    TrackKey(ctx, dbid, idx->key1, &indexTrackingCallbacks, idx);
+    TrackKey(ctx, dbid, idx->key2, &indexTrackingCallbacks, idx);
+
+    name = indexName(dbid, argv[1], argv[2], &namelen);
+    RedisModule_DictSetC(indexes, name, namelen, idx);
+    RedisModule_Free(name);
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+    return REDISMODULE_OK;
+}
+
+int ZInterIndexDrop_RedisCommand(RedisModuleCtx *ctx,
+                                 RedisModuleString **argv,
+                                 int argc) {
+    if (argc != 3) return RedisModule_WrongArity(ctx);
+
+    RedisModule_ReplyWithLongLong(ctx, indexes != NULL &&
+            indexDrop(RedisModule_GetSelectedDb(ctx), argv[1], argv[2]));
+    return REDISMODULE_OK;
+}
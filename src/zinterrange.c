@@ -1,6 +1,8 @@
 #include "redismodule.h"
+#include "redis-fast-set-ops.h"
 #include <ctype.h>
 #include <errno.h>
+#include <float.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,115 +29,228 @@ int string2d(const char *s, size_t slen, double *dp) {
 }
 
 
-int zdiffinterrangebyscoreGenericCommand(RedisModuleCtx *ctx,
-                                         RedisModuleString **argv,
-                                         int argc,
-                                         int reverse,
-                                         int isdiff) {
-    RedisModuleKey *zset = NULL, *diffinterset = NULL;
-    const char *startstr;
-    size_t startstrlen;
-    int startex = 0;
-    double start;
-    const char *endstr;
-    size_t endstrlen;
-    int endex = 0;
-    double end;
-    int withscores = 0;
-    long long limit = -1;
-    long long offset = 0;
-    long long rangelen = 0;
-    RedisModuleString *elem;
-    double zscore, interdiffscore;
+/* Parse a ZRANGEBYSCORE style score bound, where a leading '(' marks the
+   bound as exclusive. */
+static int parseScoreBound(RedisModuleString *arg, double *score, int *ex) {
+    size_t len;
+    const char *str = RedisModule_StringPtrLen(arg, &len);
 
-    if (argc < 5) {
-        // ZINTERRANGE only supports exactly two input keys with a range
-        return RedisModule_WrongArity(ctx);
-    } else if (argc >= 6) {
-        RedisModuleString **suffix_args = argv + 5;
-        int suffixargc = argc - 5;
+    *ex = 0;
+    if (len > 0 && str[0] == '(') {
+        /* this marks an exlusive interval */
+        *ex = 1;
+        str++;
+        len--;
+    }
+    return string2d(str, len, score) ? REDISMODULE_OK : REDISMODULE_ERR;
+}
 
-        RedisModule_Log(ctx, "warning",RedisModule_StringPtrLen(suffix_args[0], NULL));
+/* Parse the start and end score arguments of a range command into args,
+   swapping them for the reverse commands so min <= max holds for any
+   non-empty range. On failure an error is replied and REDISMODULE_ERR is
+   returned. */
+int parseZRangeScores(RedisModuleCtx *ctx,
+                      RedisModuleString *startarg,
+                      RedisModuleString *endarg,
+                      int reverse,
+                      ZRangeArgs *args) {
+    double start, end;
+    int startex, endex;
+
+    if (parseScoreBound(startarg, &start, &startex) == REDISMODULE_ERR ||
+            parseScoreBound(endarg, &end, &endex) == REDISMODULE_ERR) {
+        RedisModule_ReplyWithError(ctx, "ERR min or max is not a float");
+        return REDISMODULE_ERR;
+    }
 
-        if (strcasecmp(RedisModule_StringPtrLen(suffix_args[0], NULL),
-                       "withscores") == 0) {
-            withscores = 1;
+    if (reverse) {
+        args->min = end;
+        args->minex = endex;
+        args->max = start;
+        args->maxex = startex;
+    } else {
+        args->min = start;
+        args->minex = startex;
+        args->max = end;
+        args->maxex = endex;
+    }
+    return REDISMODULE_OK;
+}
+
+/* Parse the optional WITHSCORES, LIMIT offset count and INCLUDEIF/EXCLUDEIF
+   min max suffix shared by the range commands, in any order. On failure an
+   error is replied and REDISMODULE_ERR is returned. */
+int parseZRangeSuffix(RedisModuleCtx *ctx,
+                      RedisModuleString **suffix_args,
+                      int suffixargc,
+                      ZRangeArgs *args) {
+    args->withscores = 0;
+    args->offset = 0;
+    args->limit = -1;
+    args->filter = ZRANGE_FILTER_NONE;
+
+    while (suffixargc > 0) {
+        const char *opt = RedisModule_StringPtrLen(suffix_args[0], NULL);
+
+        if (strcasecmp(opt, "withscores") == 0) {
+            args->withscores = 1;
             suffix_args++;
             suffixargc--;
-        }
-
-        if (suffixargc >= 3 &&
-                strcasecmp(RedisModule_StringPtrLen(suffix_args[0], NULL),
-                           "limit") == 0) {
-            if (RedisModule_StringToLongLong(suffix_args[1], &offset)
+        } else if (suffixargc >= 3 && strcasecmp(opt, "limit") == 0) {
+            if (RedisModule_StringToLongLong(suffix_args[1], &args->offset)
                     == REDISMODULE_ERR) {
                 RedisModule_ReplyWithError(
                         ctx, "ERR offset arg is not a valid integer");
                 return REDISMODULE_ERR;
             }
-            if (RedisModule_StringToLongLong(suffix_args[2], &limit)
+            if (RedisModule_StringToLongLong(suffix_args[2], &args->limit)
                     == REDISMODULE_ERR) {
                 RedisModule_ReplyWithError(
                         ctx, "ERR limit arg is not a valid integer");
                 return REDISMODULE_ERR;
             }
-
+            /* like ZRANGEBYSCORE, any negative count means no limit and a
+               negative offset means an empty range */
+            if (args->limit < 0) args->limit = -1;
+            if (args->offset < 0) args->limit = 0;
             suffix_args += 3;
             suffixargc -= 3;
+        } else if (suffixargc >= 3 && (strcasecmp(opt, "includeif") == 0 ||
+                                       strcasecmp(opt, "excludeif") == 0)) {
+            args->filter = strcasecmp(opt, "includeif") == 0 ?
+                ZRANGE_FILTER_INCLUDEIF : ZRANGE_FILTER_EXCLUDEIF;
+            if (parseScoreBound(suffix_args[1], &args->filtermin,
+                                &args->filterminex) == REDISMODULE_ERR ||
+                    parseScoreBound(suffix_args[2], &args->filtermax,
+                                    &args->filtermaxex) == REDISMODULE_ERR) {
+                RedisModule_ReplyWithError(
+                        ctx, "ERR filter min or max is not a float");
+                return REDISMODULE_ERR;
+            }
+            suffix_args += 3;
+            suffixargc -= 3;
+        } else {
+            RedisModule_WrongArity(ctx);
+            return REDISMODULE_ERR;
         }
+    }
 
-        // support WITHSCORES after LIMIT as well
-        if (suffixargc == 1 &&
-                strcasecmp(RedisModule_StringPtrLen(suffix_args[0], NULL),
-                           "withscores") == 0) {
-            withscores = 1;
-            suffix_args++;
-            suffixargc--;
-        } else if (suffixargc > 0) {
-            return RedisModule_WrongArity(ctx);
-        }
+    return REDISMODULE_OK;
+}
 
-    }
+/* Whether score falls in the INCLUDEIF/EXCLUDEIF window of args. */
+static int inFilterWindow(const ZRangeArgs *args, double score) {
+    return (args->filterminex ? score > args->filtermin :
+                                score >= args->filtermin) &&
+           (args->filtermaxex ? score < args->filtermax :
+                                score <= args->filtermax);
+}
 
-    /* Get and sanitize indexes. */
-    startstr = RedisModule_StringPtrLen(argv[3], &startstrlen);
-    if (startstr[0] == '(') {
-        /* this marks an exlusive interval */
-        startex = 1;
-        startstr++;
-        startstrlen--;
-    }
-    if (!string2d(startstr, startstrlen, &start)) {
-        RedisModule_ReplyWithError(ctx, "ERR min or max is not a float");
-        return REDISMODULE_ERR;
+/* Scan the elements of zset within the bounds of segment, replying with the
+   ones that pass the membership test against diffinterset. The offset and
+   limit in args are carried across calls, so a range can be scanned in
+   several segments. */
+static void zdiffinterScanRange(RedisModuleCtx *ctx,
+                                RedisModuleKey *zset,
+                                RedisModuleKey *diffinterset,
+                                const ZRangeArgs *segment,
+                                ZRangeArgs *args,
+                                long long *rangelen,
+                                int reverse,
+                                int isdiff) {
+    RedisModuleString *elem;
+    double zscore, interdiffscore;
+
+    /* set up iterator for scored input */
+    if (reverse) {
+        RedisModule_ZsetLastInScoreRange(zset, segment->min, segment->max,
+                                         segment->minex, segment->maxex);
+    } else {
+        RedisModule_ZsetFirstInScoreRange(zset, segment->min, segment->max,
+                                          segment->minex, segment->maxex);
     }
-    endstr = RedisModule_StringPtrLen(argv[4], &endstrlen);
-    if (endstr[0] == '(') {
-        /* this marks an exlusive interval */
-        endex = 1;
-        endstr++;
-        endstrlen--;
+
+    while ((args->limit == -1 || *rangelen < args->limit) &&
+            RedisModule_ZsetRangeEndReached(zset) == 0) {
+        elem = RedisModule_ZsetRangeCurrentElement(zset, &zscore);
+        // could consider swapping loop order based on size
+        /* an element of the second set only counts as a match when its
+           score there falls in the INCLUDEIF/EXCLUDEIF window, if any. we
+           add this element of the first set to the reply if it matches for
+           an inter, or doesn't for a diff (also when the second set is
+           empty).
+        */
+        int found = diffinterset != NULL &&
+            RedisModule_ZsetScore(diffinterset, elem, &interdiffscore)
+                == REDISMODULE_OK &&
+            (args->filter == ZRANGE_FILTER_NONE ||
+             inFilterWindow(args, interdiffscore));
+        if (found != isdiff) {
+            if (args->offset-- <= 0) {
+                RedisModule_ReplyWithString(ctx, elem);
+                if (args->withscores) {
+                    RedisModule_ReplyWithDouble(ctx, zscore);
+                }
+                (*rangelen)++;
+            }
+        }
+
+        RedisModule_FreeString(ctx, elem);
+
+        // advance the iterator
+        if (reverse) {
+            RedisModule_ZsetRangePrev(zset);
+        } else {
+            RedisModule_ZsetRangeNext(zset);
+        }
     }
-    if (!string2d(endstr, endstrlen, &end)) {
-        RedisModule_ReplyWithError(ctx, "ERR min or max is not a float");
+
+    RedisModule_ZsetRangeStop(zset);
+}
+
+/* Check that the INCLUDEIF/EXCLUDEIF option in args, if any, matches the
+   kind of range command. On failure an error is replied and REDISMODULE_ERR
+   is returned. */
+int checkZRangeFilter(RedisModuleCtx *ctx, const ZRangeArgs *args, int isdiff) {
+    if (args->filter == (isdiff ? ZRANGE_FILTER_INCLUDEIF :
+                                  ZRANGE_FILTER_EXCLUDEIF)) {
+        RedisModule_ReplyWithError(ctx, isdiff ?
+            "ERR INCLUDEIF is only supported by intersections, use EXCLUDEIF" :
+            "ERR EXCLUDEIF is only supported by differences, use INCLUDEIF");
         return REDISMODULE_ERR;
     }
-    /* The range is empty when start > end, or the inverse if the reverse
-     * flag is on. */
-    if (reverse ^ (start > end)) {
+    return REDISMODULE_OK;
+}
+
+/* Reply with the range of key1 in args that is in key2 (or not in key2 if
+   isdiff is set), once the arguments are parsed. */
+int zdiffinterrangebyscoreWithArgs(RedisModuleCtx *ctx,
+                                   RedisModuleString *key1,
+                                   RedisModuleString *key2,
+                                   const ZRangeArgs *argsp,
+                                   int reverse,
+                                   int isdiff) {
+    RedisModuleKey *zset = NULL, *diffinterset = NULL;
+    ZRangeArgs args = *argsp, segment;
+    ZInterIndex *idx;
+    ZInterIndexIter it;
+    long long rangelen = 0;
+
+    /* The range is empty when min > max. */
+    if (args.min > args.max) {
         RedisModule_ReplyWithArray(ctx, 0);
         return REDISMODULE_OK;
     }
 
     /* read keys to be used for input */
-    if ((zset = RedisModule_OpenKey(ctx,argv[1],REDISMODULE_READ)) != NULL
+    if ((zset = RedisModule_OpenKey(ctx,key1,REDISMODULE_READ)) != NULL
          && RedisModule_KeyType(zset) != REDISMODULE_KEYTYPE_ZSET) {
         RedisModule_CloseKey(zset);
         RedisModule_ReplyWithError(ctx,
                                    "WRONGTYPE Operation against a key holding the wrong kind of value");
         return REDISMODULE_ERR;
     }
-    if ((diffinterset = RedisModule_OpenKey(ctx,argv[2],REDISMODULE_READ)) != NULL
+    if ((diffinterset = RedisModule_OpenKey(ctx,key2,REDISMODULE_READ)) != NULL
          && RedisModule_KeyType(diffinterset) != REDISMODULE_KEYTYPE_ZSET) {
         RedisModule_CloseKey(zset);
         RedisModule_CloseKey(diffinterset);
@@ -162,57 +277,60 @@ int zdiffinterrangebyscoreGenericCommand(RedisModuleCtx *ctx,
         }
     }
 
-    /* set up iterator for scored input */
-    if (reverse) {
-        RedisModule_ZsetLastInScoreRange(zset, end, start, endex, startex);
-    } else {
-        RedisModule_ZsetFirstInScoreRange(zset, start, end, startex, endex);
-    }
+    /* intersections only need to scan the parts of the range that an index
+       over the two keys shows to hold members of both */
+    idx = isdiff ? NULL : GetZInterIndex(ctx, key1, key2);
 
     RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
 
-    int chkval = isdiff ? REDISMODULE_ERR : REDISMODULE_OK;
-    while ((limit == -1 || rangelen < limit) &&
-            RedisModule_ZsetRangeEndReached(zset) == 0) {
-        elem = RedisModule_ZsetRangeCurrentElement(zset, &zscore);
-        // could consider swapping loop order based on size
-        /* this conditional determines whether we add this element of the first
-         set to the reply, which we do if this is a diff and the second set
-         is empty or if the membership test for the element in the second set
-         results in the value we're looking for, which is success if this is an
-         inter or error if this is a diff.
-        */
-        if ((isdiff && diffinterset == NULL) ||
-            RedisModule_ZsetScore(diffinterset, elem, &interdiffscore) == chkval) {
-            if (offset-- <= 0) {
-                RedisModule_ReplyWithString(ctx, elem);
-                if (withscores) {
-                    RedisModule_ReplyWithDouble(ctx, zscore);
-                }
-                rangelen++;
-            }
-        }
-
-        RedisModule_FreeString(ctx, elem);
-
-        // advance the iterator
-        if (reverse) {
-            RedisModule_ZsetRangePrev(zset);
-        } else {
-            RedisModule_ZsetRangeNext(zset);
+    if (idx != NULL) {
+        ZInterIndexIterStart(&it, idx, &args, reverse);
+        while ((args.limit == -1 || rangelen < args.limit) &&
+                ZInterIndexIterNext(&it, &segment)) {
+            zdiffinterScanRange(ctx, zset, diffinterset, &segment, &args,
+                                &rangelen, reverse, isdiff);
         }
+        ZInterIndexIterStop(&it);
+    } else {
+        zdiffinterScanRange(ctx, zset, diffinterset, &args, &args, &rangelen,
+                            reverse, isdiff);
     }
 
-    RedisModule_ReplySetArrayLength(ctx, rangelen * (1 + withscores));
+    RedisModule_ReplySetArrayLength(ctx, rangelen * (1 + args.withscores));
 
     // cleanup
-    RedisModule_ZsetRangeStop(zset);
     RedisModule_CloseKey(zset);
     RedisModule_CloseKey(diffinterset);
 
     return REDISMODULE_OK;
 }
 
+int zdiffinterrangebyscoreGenericCommand(RedisModuleCtx *ctx,
+                                         RedisModuleString **argv,
+                                         int argc,
+                                         int reverse,
+                                         int isdiff) {
+    ZRangeArgs args;
+
+    if (argc < 5) {
+        // ZINTERRANGE only supports exactly two input keys with a range
+        return RedisModule_WrongArity(ctx);
+    }
+
+    if (parseZRangeSuffix(ctx, argv + 5, argc - 5, &args) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+    if (checkZRangeFilter(ctx, &args, isdiff) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    /* Get and sanitize indexes. */
+    if (parseZRangeScores(ctx, argv[3], argv[4], reverse, &args)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    return zdiffinterrangebyscoreWithArgs(ctx, argv[1], argv[2], &args,
+                                          reverse, isdiff);
+}
+
 int ZDiffRangeByScore_RedisCommand(RedisModuleCtx *ctx,
                                    RedisModuleString **argv,
                                    int argc) {
@@ -237,3 +355,166 @@ int ZInterRevRangeByScore_RedisCommand(RedisModuleCtx *ctx,
                                        int argc) {
     return zdiffinterrangebyscoreGenericCommand(ctx, argv, argc, 1, 0);
 }
+
+static void replyWithGroupedRow(RedisModuleCtx *ctx,
+                                double start,
+                                long long *counts,
+                                int numfilters) {
+    RedisModule_ReplyWithArray(ctx, 1 + numfilters);
+    RedisModule_ReplyWithDouble(ctx, start);
+    for (int i = 0; i < numfilters; i++) {
+        RedisModule_ReplyWithLongLong(ctx, counts[i]);
+        counts[i] = 0;
+    }
+}
+
+/* Return the ZINTERCARD.GROUPED bucket of score. Scores and widths are
+   usually written in decimal, which doubles only approximate, so the
+   quotient of a score on a bucket edge can fall just short of the edge
+   (0.3 - 0.1 over 0.1 gives 1.9999999999999998). Quotients within the
+   rounding error of the next edge are taken to be on it. */
+static double groupedBucket(double min, double width, double score) {
+    double q = (score - min) / width;
+    double bucket = floor(q);
+    double err = 4 * DBL_EPSILON * ((fabs(score) + fabs(min)) / width +
+                                    fabs(q));
+
+    if (bucket + 1 - q <= err) bucket++;
+    return bucket;
+}
+
+/* Return the position of the first filter of a ZINTERCARD.GROUPED call, or
+   -1 when FILTERS isn't followed by any. */
+static int groupedFiltersPos(RedisModuleString **argv, int argc) {
+    int pos = 4;
+
+    if (argc > 6 && strcasecmp(RedisModule_StringPtrLen(argv[pos], NULL),
+                               "bucket") == 0)
+        pos += 2;
+    if (pos >= argc - 1 ||
+            strcasecmp(RedisModule_StringPtrLen(argv[pos], NULL),
+                       "filters") != 0)
+        return -1;
+    return pos + 1;
+}
+
+/* ZINTERCARD.GROUPED source min max [BUCKET width] FILTERS filter [filter ...]
+
+   Walk the range of source once, counting for every bucket of scores how
+   many of its members are in each filter. Buckets are width wide starting
+   at min, and only buckets holding members of source are replied, as rows
+   of the bucket start followed by one count per filter. Without BUCKET the
+   whole range is a single bucket. */
+int ZInterCardGrouped_RedisCommand(RedisModuleCtx *ctx,
+                                   RedisModuleString **argv,
+                                   int argc) {
+    RedisModuleKey *zset, **filters;
+    RedisModuleString *elem;
+    ZRangeArgs args;
+    long long *counts, numrows = 0;
+    double width = 0, bucket = 0, zscore, filterscore;
+    int numfilters, inbucket = 0, pos;
+
+    /* The filters are keys too, but first/last/step can't express them.
+       Malformed calls declare no keys, they fail below anyway. */
+    if (RedisModule_IsKeysPositionRequest(ctx)) {
+        if (argc >= 6 && (pos = groupedFiltersPos(argv, argc)) != -1) {
+            RedisModule_KeyAtPos(ctx, 1);
+            for (int i = pos; i < argc; i++) {
+                RedisModule_KeyAtPos(ctx, i);
+            }
+        }
+        return REDISMODULE_OK;
+    }
+
+    if (argc < 6 || (pos = groupedFiltersPos(argv, argc)) == -1)
+        return RedisModule_WrongArity(ctx);
+
+    if (pos > 5 && (RedisModule_StringToDouble(argv[5], &width)
+                        == REDISMODULE_ERR ||
+                    !(width > 0) || isinf(width))) {
+        RedisModule_ReplyWithError(ctx, "ERR width must be a positive number");
+        return REDISMODULE_ERR;
+    }
+
+    if (parseZRangeScores(ctx, argv[2], argv[3], 0, &args) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+    if (width > 0 && isinf(args.min)) {
+        RedisModule_ReplyWithError(ctx, "ERR BUCKET needs a finite min");
+        return REDISMODULE_ERR;
+    }
+
+    if ((zset = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ)) != NULL
+         && RedisModule_KeyType(zset) != REDISMODULE_KEYTYPE_ZSET) {
+        RedisModule_CloseKey(zset);
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+
+    numfilters = argc - pos;
+    filters = RedisModule_Calloc(numfilters, sizeof(*filters));
+    counts = RedisModule_Calloc(numfilters, sizeof(*counts));
+    for (int i = 0; i < numfilters; i++) {
+        filters[i] = RedisModule_OpenKey(ctx, argv[pos + i], REDISMODULE_READ);
+        if (filters[i] != NULL &&
+                RedisModule_KeyType(filters[i]) != REDISMODULE_KEYTYPE_ZSET) {
+            for (int j = 0; j <= i; j++) {
+                RedisModule_CloseKey(filters[j]);
+            }
+            RedisModule_CloseKey(zset);
+            RedisModule_Free(filters);
+            RedisModule_Free(counts);
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+
+    if (zset != NULL && args.min <= args.max) {
+        RedisModule_ZsetFirstInScoreRange(zset, args.min, args.max,
+                                          args.minex, args.maxex);
+        while (RedisModule_ZsetRangeEndReached(zset) == 0) {
+            double b;
+
+            elem = RedisModule_ZsetRangeCurrentElement(zset, &zscore);
+            b = width > 0 ? groupedBucket(args.min, width, zscore) : 0;
+            if (inbucket && b != bucket) {
+                replyWithGroupedRow(ctx, width > 0 ? args.min + bucket * width :
+                                                     args.min,
+                                    counts, numfilters);
+                numrows++;
+            }
+            bucket = b;
+            inbucket = 1;
+
+            for (int i = 0; i < numfilters; i++) {
+                if (filters[i] != NULL &&
+                        RedisModule_ZsetScore(filters[i], elem, &filterscore)
+                            == REDISMODULE_OK)
+                    counts[i]++;
+            }
+
+            RedisModule_FreeString(ctx, elem);
+            RedisModule_ZsetRangeNext(zset);
+        }
+        RedisModule_ZsetRangeStop(zset);
+
+        if (inbucket) {
+            replyWithGroupedRow(ctx, width > 0 ? args.min + bucket * width :
+                                                 args.min,
+                                counts, numfilters);
+            numrows++;
+        }
+    }
+
+    RedisModule_ReplySetArrayLength(ctx, numrows);
+
+    for (int i = 0; i < numfilters; i++) {
+        RedisModule_CloseKey(filters[i]);
+    }
+    RedisModule_CloseKey(zset);
+    RedisModule_Free(filters);
+    RedisModule_Free(counts);
+    return REDISMODULE_OK;
+}
@@ -0,0 +1,640 @@
+#define REDISMODULE_EXPERIMENTAL_API
+#include "redismodule.h"
+#include "redis-fast-set-ops.h"
+#include <stdint.h>
+#include <string.h>
+
+/*  ZINTERVIEW maintains the intersection of a set of sorted sets as a module
+    data type, so it can be range queried in O(log(N)+M) no matter how large
+    the source sets are. Scores are taken from the first source key, exactly
+    like ZINTERRANGEBYSCORE.
+
+    The view is kept in two radix trees: one ordered by an 8 byte sortable
+    encoding of the score followed by the member, which serves the range
+    queries, and one from member to score, which lets us find a member's
+    position when it changes. Member deltas reported by the key tracking
+    layer are applied in place; any other change to a source key marks the
+    view stale and it is rebuilt on its next read.  */
+
+#define ZINTERVIEW_ENCODING_VERSION 0
+
+typedef struct {
+    int dbid;
+    int numkeys;
+    RedisModuleString **keys;  // keys[0] is the source of truth for scores
+    RedisModuleDict *byscore;  // sortable score + member -> NULL
+    RedisModuleDict *bymember; // member -> double *score
+    size_t memberbytes;
+    unsigned long long epoch;
+    int stale;
+    int freed;                 // set by ZInterViewFree, possibly off thread
+} ZInterView;
+
+static RedisModuleType *ZInterViewType;
+
+/* Every view, by address. Redis may free a view on its lazyfree thread
+   (FLUSHALL ASYNC, or a replica flushing for a full sync), where it can't
+   touch the key tracking layer. So ZInterViewFree only flags the view, and
+   flagged views are untracked and released from here on the main thread
+   before the next command runs. Until then the tracking callbacks skip
+   them. */
+static RedisModuleDict *trackedviews = NULL;
+static int viewsfreed = 0;
+
+static int viewFreed(ZInterView *v) {
+    return __atomic_load_n(&v->freed, __ATOMIC_ACQUIRE);
+}
+
+/* Map a score onto an unsigned integer with the same ordering, so its big
+   endian bytes sort correctly inside the radix tree. */
+static uint64_t scoreToSortable(double score) {
+    uint64_t bits;
+
+    if (score == 0) score = 0; // fold -0.0 into 0.0
+    memcpy(&bits, &score, sizeof(bits));
+    if (bits & 0x8000000000000000ULL) return ~bits;
+    return bits | 0x8000000000000000ULL;
+}
+
+static double sortableToScore(uint64_t bits) {
+    double score;
+
+    if (bits & 0x8000000000000000ULL) {
+        bits &= ~0x8000000000000000ULL;
+    } else {
+        bits = ~bits;
+    }
+    memcpy(&score, &bits, sizeof(score));
+    return score;
+}
+
+static void putSortable(unsigned char *buf, uint64_t bits) {
+    for (int i = 7; i >= 0; i--) {
+        buf[i] = bits & 0xff;
+        bits >>= 8;
+    }
+}
+
+static uint64_t getSortable(const unsigned char *buf) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) {
+        bits = (bits << 8) | buf[i];
+    }
+    return bits;
+}
+
+static unsigned char *scoreKey(double score,
+                               const char *member,
+                               size_t len,
+                               size_t *keylen) {
+    unsigned char *key = RedisModule_Alloc(8 + len);
+    putSortable(key, scoreToSortable(score));
+    memcpy(key + 8, member, len);
+    *keylen = 8 + len;
+    return key;
+}
+
+static void viewRemoveMember(ZInterView *v, const char *member, size_t len) {
+    double *score = RedisModule_DictGetC(v->bymember, (void *)member, len,
+                                         NULL);
+    unsigned char *key;
+    size_t keylen;
+
+    if (score == NULL) return;
+
+    key = scoreKey(*score, member, len, &keylen);
+    RedisModule_DictDelC(v->byscore, key, keylen, NULL);
+    RedisModule_DictDelC(v->bymember, (void *)member, len, NULL);
+    RedisModule_Free(key);
+    RedisModule_Free(score);
+    v->memberbytes -= len;
+}
+
+static void viewSetMember(ZInterView *v,
+                          const char *member,
+                          size_t len,
+                          double score) {
+    double *oldscore = RedisModule_DictGetC(v->bymember, (void *)member, len,
+                                            NULL);
+    unsigned char *key;
+    size_t keylen;
+
+    if (oldscore != NULL) {
+        if (*oldscore == score) return;
+        viewRemoveMember(v, member, len);
+    }
+
+    double *newscore = RedisModule_Alloc(sizeof(*newscore));
+    *newscore = score;
+    RedisModule_DictSetC(v->bymember, (void *)member, len, newscore);
+
+    key = scoreKey(score, member, len, &keylen);
+    RedisModule_DictSetC(v->byscore, key, keylen, NULL);
+    RedisModule_Free(key);
+    v->memberbytes += len;
+}
+
+static void viewClear(ZInterView *v) {
+    RedisModuleDictIter *iter;
+    void *score;
+
+    if (v->bymember != NULL) {
+        iter = RedisModule_DictIteratorStartC(v->bymember, "^", NULL, 0);
+        while (RedisModule_DictNextC(iter, NULL, &score) != NULL) {
+            RedisModule_Free(score);
+        }
+        RedisModule_DictIteratorStop(iter);
+        RedisModule_FreeDict(NULL, v->bymember);
+        RedisModule_FreeDict(NULL, v->byscore);
+    }
+    v->bymember = RedisModule_CreateDict(NULL);
+    v->byscore = RedisModule_CreateDict(NULL);
+    v->memberbytes = 0;
+}
+
+/* Open the source keys of the view, returning NULL for keys that are missing
+   or no longer sorted sets since both mean the intersection is empty. */
+static int viewOpenKeys(RedisModuleCtx *ctx,
+                        ZInterView *v,
+                        RedisModuleKey **zsets) {
+    int found = 1;
+
+    for (int i = 0; i < v->numkeys; i++) {
+        zsets[i] = RedisModule_OpenKey(ctx, v->keys[i], REDISMODULE_READ);
+        if (zsets[i] != NULL &&
+                RedisModule_KeyType(zsets[i]) != REDISMODULE_KEYTYPE_ZSET) {
+            RedisModule_CloseKey(zsets[i]);
+            zsets[i] = NULL;
+        }
+        if (zsets[i] == NULL) found = 0;
+    }
+    return found;
+}
+
+static void viewCloseKeys(ZInterView *v, RedisModuleKey **zsets) {
+    for (int i = 0; i < v->numkeys; i++) {
+        RedisModule_CloseKey(zsets[i]);
+    }
+}
+
+/* Recompute the whole view from its source keys. We scan the smallest source
+   and probe the others, taking the score from the first key. */
+static void viewRebuild(RedisModuleCtx *ctx, ZInterView *v) {
+    RedisModuleKey **zsets = RedisModule_Alloc(sizeof(*zsets) * v->numkeys);
+    RedisModuleString *elem;
+    double score, probescore;
+    int scan = 0;
+
+    viewClear(v);
+    v->stale = 0;
+    v->epoch = TrackingEpoch();
+
+    if (!viewOpenKeys(ctx, v, zsets)) {
+        viewCloseKeys(v, zsets);
+        RedisModule_Free(zsets);
+        return;
+    }
+
+    for (int i = 1; i < v->numkeys; i++) {
+        if (RedisModule_ValueLength(zsets[i]) <
+                RedisModule_ValueLength(zsets[scan]))
+            scan = i;
+    }
+
+    RedisModule_ZsetFirstInScoreRange(zsets[scan],
+                                      REDISMODULE_NEGATIVE_INFINITE,
+                                      REDISMODULE_POSITIVE_INFINITE, 0, 0);
+    while (RedisModule_ZsetRangeEndReached(zsets[scan]) == 0) {
+        int i;
+
+        elem = RedisModule_ZsetRangeCurrentElement(zsets[scan], &score);
+        if (scan != 0 &&
+                RedisModule_ZsetScore(zsets[0], elem, &score)
+                    == REDISMODULE_ERR) {
+            i = 0;
+        } else {
+            for (i = 1; i < v->numkeys; i++) {
+                if (i != scan &&
+                        RedisModule_ZsetScore(zsets[i], elem, &probescore)
+                            == REDISMODULE_ERR)
+                    break;
+            }
+        }
+
+        if (i == v->numkeys) {
+            size_t len;
+            const char *member = RedisModule_StringPtrLen(elem, &len);
+            viewSetMember(v, member, len, score);
+        }
+
+        RedisModule_FreeString(ctx, elem);
+        RedisModule_ZsetRangeNext(zsets[scan]);
+    }
+    RedisModule_ZsetRangeStop(zsets[scan]);
+
+    viewCloseKeys(v, zsets);
+    RedisModule_Free(zsets);
+}
+
+static void viewMemberChanged(RedisModuleCtx *ctx,
+                              void *owner,
+                              RedisModuleString *key,
+                              RedisModuleString *member) {
+    ZInterView *v = owner;
+    RedisModuleKey **zsets;
+    double score, probescore;
+    size_t len;
+    const char *memberstr = RedisModule_StringPtrLen(member, &len);
+    int i = 0;
+    REDISMODULE_NOT_USED(key);
+
+    // a stale view is rebuilt from scratch on its next read anyway
+    if (v->stale || viewFreed(v)) return;
+
+    zsets = RedisModule_Alloc(sizeof(*zsets) * v->numkeys);
+    if (viewOpenKeys(ctx, v, zsets) &&
+            RedisModule_ZsetScore(zsets[0], member, &score) == REDISMODULE_OK) {
+        for (i = 1; i < v->numkeys; i++) {
+            if (RedisModule_ZsetScore(zsets[i], member, &probescore)
+                    == REDISMODULE_ERR)
+                break;
+        }
+    }
+
+    if (i == v->numkeys) {
+        viewSetMember(v, memberstr, len, score);
+    } else {
+        viewRemoveMember(v, memberstr, len);
+    }
+
+    viewCloseKeys(v, zsets);
+    RedisModule_Free(zsets);
+}
+
+static void viewKeyChanged(RedisModuleCtx *ctx,
+                           void *owner,
+                           RedisModuleString *key) {
+    ZInterView *v = owner;
+    REDISMODULE_NOT_USED(ctx);
+    REDISMODULE_NOT_USED(key);
+
+    v->stale = 1;
+}
+
+static const TrackingCallbacks viewTrackingCallbacks = {
+    viewMemberChanged,
+    viewKeyChanged
+};
+
+static ZInterView *viewCreate(int dbid, int numkeys) {
+    ZInterView *v = RedisModule_Calloc(1, sizeof(*v));
+
+    v->dbid = dbid;
+    v->numkeys = numkeys;
+    v->keys = RedisModule_Calloc(numkeys, sizeof(*v->keys));
+    viewClear(v);
+    return v;
+}
+
+static void viewTrack(RedisModuleCtx *ctx, ZInterView *v) {
+    for (int i = 0; i < v->numkeys; i++) {
+        TrackKey(ctx, v->dbid, v->keys[i], &viewTrackingCallbacks, v);
+    }
+    RedisModule_DictReplaceC(trackedviews, &v, sizeof(v), v);
+}
+
+static void viewUntrack(ZInterView *v) {
+    for (int i = 0; i < v->numkeys; i++) {
+        UntrackKey(v->dbid, v->keys[i], v);
+    }
+    RedisModule_DictDelC(trackedviews, &v, sizeof(v), NULL);
+}
+
+static void viewRelease(ZInterView *v) {
+    viewUntrack(v);
+    for (int i = 0; i < v->numkeys; i++) {
+        RedisModule_FreeString(NULL, v->keys[i]);
+    }
+    viewClear(v);
+    RedisModule_FreeDict(NULL, v->bymember);
+    RedisModule_FreeDict(NULL, v->byscore);
+    RedisModule_Free(v->keys);
+    RedisModule_Free(v);
+}
+
+/* Runs on the main thread before every command while keys are tracked. */
+static void releaseFreedViews(void) {
+    RedisModuleDictIter *iter;
+    ZInterView *v, **freed = NULL;
+    size_t numfreed = 0;
+
+    if (!__atomic_exchange_n(&viewsfreed, 0, __ATOMIC_ACQ_REL)) return;
+
+    iter = RedisModule_DictIteratorStartC(trackedviews, "^", NULL, 0);
+    while (RedisModule_DictNextC(iter, NULL, (void **)&v) != NULL) {
+        if (!viewFreed(v)) continue;
+        freed = RedisModule_Realloc(freed, sizeof(*freed) * (numfreed + 1));
+        freed[numfreed++] = v;
+    }
+    RedisModule_DictIteratorStop(iter);
+
+    for (size_t i = 0; i < numfreed; i++) {
+        viewRelease(freed[i]);
+    }
+    RedisModule_Free(freed);
+}
+
+static void ZInterViewFree(void *value) {
+    ZInterView *v = value;
+
+    __atomic_store_n(&v->freed, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&viewsfreed, 1, __ATOMIC_RELEASE);
+}
+
+static void ZInterViewRdbSave(RedisModuleIO *rdb, void *value) {
+    ZInterView *v = value;
+    RedisModuleDictIter *iter;
+    unsigned char *key;
+    size_t keylen;
+
+    RedisModule_SaveSigned(rdb, v->dbid);
+    RedisModule_SaveUnsigned(rdb, v->numkeys);
+    for (int i = 0; i < v->numkeys; i++) {
+        RedisModule_SaveString(rdb, v->keys[i]);
+    }
+
+    // a stale view is saved without members and rebuilt after loading
+    RedisModule_SaveUnsigned(rdb, v->stale);
+    if (v->stale) return;
+
+    RedisModule_SaveUnsigned(rdb, RedisModule_DictSize(v->bymember));
+    iter = RedisModule_DictIteratorStartC(v->byscore, "^", NULL, 0);
+    while ((key = RedisModule_DictNextC(iter, &keylen, NULL)) != NULL) {
+        RedisModule_SaveStringBuffer(rdb, (char *)key + 8, keylen - 8);
+        RedisModule_SaveDouble(rdb, sortableToScore(getSortable(key)));
+    }
+    RedisModule_DictIteratorStop(iter);
+}
+
+static void *ZInterViewRdbLoad(RedisModuleIO *rdb, int encver) {
+    ZInterView *v;
+    int dbid, numkeys;
+
+    if (encver != ZINTERVIEW_ENCODING_VERSION) {
+        RedisModule_LogIOError(rdb, "warning",
+                               "Can't load ZINTERVIEW encoding version %d",
+                               encver);
+        return NULL;
+    }
+
+    dbid = RedisModule_LoadSigned(rdb);
+    numkeys = RedisModule_LoadUnsigned(rdb);
+    v = viewCreate(dbid, numkeys);
+    for (int i = 0; i < numkeys; i++) {
+        v->keys[i] = RedisModule_LoadString(rdb);
+    }
+
+    v->stale = RedisModule_LoadUnsigned(rdb);
+    v->epoch = TrackingEpoch();
+    if (!v->stale) {
+        uint64_t count = RedisModule_LoadUnsigned(rdb);
+        while (count--) {
+            size_t len;
+            char *member = RedisModule_LoadStringBuffer(rdb, &len);
+            double score = RedisModule_LoadDouble(rdb);
+            viewSetMember(v, member, len, score);
+            RedisModule_Free(member);
+        }
+    }
+
+    viewTrack(RedisModule_GetContextFromIO(rdb), v);
+    return v;
+}
+
+static void ZInterViewAofRewrite(RedisModuleIO *aof,
+                                 RedisModuleString *key,
+                                 void *value) {
+    ZInterView *v = value;
+    RedisModule_EmitAOF(aof, "ZINTERVIEW.CREATE", "sv", key,
+                        v->keys, (size_t)v->numkeys);
+}
+
+static size_t ZInterViewMemUsage(const void *value) {
+    const ZInterView *v = value;
+    uint64_t count = RedisModule_DictSize(v->bymember);
+
+    // each member is stored twice and carries an allocated score
+    return sizeof(*v) + v->numkeys * sizeof(*v->keys) +
+        2 * v->memberbytes + count * (8 + sizeof(double));
+}
+
+int ZInterViewInit(RedisModuleCtx *ctx) {
+    RedisModuleTypeMethods tm = {
+        .version = REDISMODULE_TYPE_METHOD_VERSION,
+        .rdb_load = ZInterViewRdbLoad,
+        .rdb_save = ZInterViewRdbSave,
+        .aof_rewrite = ZInterViewAofRewrite,
+        .mem_usage = ZInterViewMemUsage,
+        .free = ZInterViewFree
+    };
+
+    ZInterViewType = RedisModule_CreateDataType(ctx, "fso-zview",
+                                                ZINTERVIEW_ENCODING_VERSION,
+                                                &tm);
+    if (ZInterViewType == NULL) return REDISMODULE_ERR;
+
+    trackedviews = RedisModule_CreateDict(NULL);
+    TrackingOnCommand(releaseFreedViews);
+    return REDISMODULE_OK;
+}
+
+/* Open a view key for reading, rebuilding the view if it went stale. *v is
+   set to NULL when the key doesn't exist, and REDISMODULE_ERR is returned
+   after replying with an error when it isn't a view. */
+static int openView(RedisModuleCtx *ctx,
+                    RedisModuleString *keyname,
+                    RedisModuleKey **key,
+                    ZInterView **v) {
+    *v = NULL;
+    *key = RedisModule_OpenKey(ctx, keyname, REDISMODULE_READ);
+    if (*key == NULL) return REDISMODULE_OK;
+
+    if (RedisModule_ModuleTypeGetType(*key) != ZInterViewType) {
+        RedisModule_CloseKey(*key);
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+
+    *v = RedisModule_ModuleTypeGetValue(*key);
+
+    /* SWAPDB or MOVE may have taken the view to another db, where it has to
+       follow that db's keys instead. */
+    if ((*v)->dbid != RedisModule_GetSelectedDb(ctx)) {
+        viewUntrack(*v);
+        (*v)->dbid = RedisModule_GetSelectedDb(ctx);
+        viewTrack(ctx, *v);
+        (*v)->stale = 1;
+    }
+    if ((*v)->stale || (*v)->epoch != TrackingEpoch())
+        viewRebuild(ctx, *v);
+    return REDISMODULE_OK;
+}
+
+int ZInterViewCreate_RedisCommand(RedisModuleCtx *ctx,
+                                  RedisModuleString **argv,
+                                  int argc) {
+    RedisModuleKey *key, *zset;
+    ZInterView *v;
+
+    if (argc < 4) return RedisModule_WrongArity(ctx);
+
+    key = RedisModule_OpenKey(ctx, argv[1],
+                              REDISMODULE_READ|REDISMODULE_WRITE);
+    if (RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY &&
+            RedisModule_ModuleTypeGetType(key) != ZInterViewType) {
+        RedisModule_CloseKey(key);
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return REDISMODULE_ERR;
+    }
+
+    for (int i = 2; i < argc; i++) {
+        if ((zset = RedisModule_OpenKey(ctx, argv[i], REDISMODULE_READ)) != NULL
+                && RedisModule_KeyType(zset) != REDISMODULE_KEYTYPE_ZSET) {
+            RedisModule_CloseKey(zset);
+            RedisModule_CloseKey(key);
+            RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+            return REDISMODULE_ERR;
+        }
+        RedisModule_CloseKey(zset);
+    }
+
+    v = viewCreate(RedisModule_GetSelectedDb(ctx), argc - 2);
+    for (int i = 2; i < argc; i++) {
+        v->keys[i - 2] = RedisModule_CreateStringFromString(NULL, argv[i]);
+    }
+    viewRebuild(ctx, v);
+
+    // replacing an existing view frees it, see releaseFreedViews
+    RedisModule_ModuleTypeSetValue(key, ZInterViewType, v);
+    viewTrack(ctx, v);
+    RedisModule_CloseKey(key);
+
+    RedisModule_ReplicateVerbatim(ctx);
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+    return REDISMODULE_OK;
+}
+
+int zinterviewRangeGenericCommand(RedisModuleCtx *ctx,
+                                  RedisModuleString **argv,
+                                  int argc,
+                                  int reverse) {
+    RedisModuleKey *key;
+    RedisModuleDictIter *iter;
+    ZInterView *v;
+    ZRangeArgs args;
+    unsigned char bound[8];
+    unsigned char *elem;
+    size_t elemlen;
+    long long rangelen = 0;
+
+    if (argc < 4) return RedisModule_WrongArity(ctx);
+
+    if (parseZRangeSuffix(ctx, argv + 4, argc - 4, &args) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+    if (args.filter != ZRANGE_FILTER_NONE) {
+        RedisModule_ReplyWithError(ctx,
+            "ERR INCLUDEIF/EXCLUDEIF are not supported by views");
+        return REDISMODULE_ERR;
+    }
+
+    if (parseZRangeScores(ctx, argv[2], argv[3], reverse, &args)
+            == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (args.min > args.max) {
+        RedisModule_ReplyWithArray(ctx, 0);
+        return REDISMODULE_OK;
+    }
+
+    if (openView(ctx, argv[1], &key, &v) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+    if (v == NULL) {
+        RedisModule_ReplyWithArray(ctx, 0);
+        return REDISMODULE_OK;
+    }
+
+    /* An exclusive bound is the next encoded score, all members with the
+       bounding score itself sort after its bare 8 byte prefix. */
+    if (reverse) {
+        putSortable(bound, scoreToSortable(args.max) + !args.maxex);
+        iter = RedisModule_DictIteratorStartC(v->byscore, "<", bound, 8);
+    } else {
+        putSortable(bound, scoreToSortable(args.min) + args.minex);
+        iter = RedisModule_DictIteratorStartC(v->byscore, ">=", bound, 8);
+    }
+
+    RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+
+    while (args.limit == -1 || rangelen < args.limit) {
+        double score;
+
+        if (reverse) {
+            elem = RedisModule_DictPrevC(iter, &elemlen, NULL);
+        } else {
+            elem = RedisModule_DictNextC(iter, &elemlen, NULL);
+        }
+        if (elem == NULL) break;
+
+        score = sortableToScore(getSortable(elem));
+        if (reverse ? (score < args.min || (args.minex && score == args.min))
+                    : (score > args.max || (args.maxex && score == args.max)))
+            break;
+
+        if (args.offset-- <= 0) {
+            RedisModule_ReplyWithStringBuffer(ctx, (char *)elem + 8,
+                                              elemlen - 8);
+            if (args.withscores) {
+                RedisModule_ReplyWithDouble(ctx, score);
+            }
+            rangelen++;
+        }
+    }
+
+    RedisModule_ReplySetArrayLength(ctx, rangelen * (1 + args.withscores));
+
+    RedisModule_DictIteratorStop(iter);
+    RedisModule_CloseKey(key);
+    return REDISMODULE_OK;
+}
+
+int ZInterViewRangeByScore_RedisCommand(RedisModuleCtx *ctx,
+                                        RedisModuleString **argv,
+                                        int argc) {
+    return zinterviewRangeGenericCommand(ctx, argv, argc, 0);
+}
+
+int ZInterViewRevRangeByScore_RedisCommand(RedisModuleCtx *ctx,
+                                           RedisModuleString **argv,
+                                           int argc) {
+    return zinterviewRangeGenericCommand(ctx, argv, argc, 1);
+}
+
+int ZInterViewCard_RedisCommand(RedisModuleCtx *ctx,
+                                RedisModuleString **argv,
+                                int argc) {
+    RedisModuleKey *key;
+    ZInterView *v;
+
+    if (argc != 2) return RedisModule_WrongArity(ctx);
+
+    if (openView(ctx, argv[1], &key, &v) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+    if (v == NULL) {
+        RedisModule_ReplyWithLongLong(ctx, 0);
+        return REDISMODULE_OK;
+    }
+
+    RedisModule_ReplyWithLongLong(ctx, RedisModule_DictSize(v->bymember));
+    RedisModule_CloseKey(key);
+    return REDISMODULE_OK;
+}
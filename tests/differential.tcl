@@ -0,0 +1,397 @@
+# Randomized differential tests: every module command is run on random data
+# and compared against an equivalent pipeline of built-in commands, and the
+# time spent on both sides is reported at the end so changes can be checked
+# for correctness and measured in the same run. For ranges the built-in side
+# is only timed for the ZRANGEBYSCORE over an intersection stored beforehand,
+# the read that a module call replaces.
+
+# get the path of the test module in order to reference the absolute path of the tested module
+set moduleLocation [file dirname [file normalize [info script]]]
+dict set options overrides "loadmodule ${moduleLocation}/../src/redis-fast-set-ops.so"
+
+# random queries per dataset, and size of the throughput datasets; raise them
+# for longer runs
+set ::diff_queries 100
+set ::diff_throughput_size 20000
+
+start_server $options {
+    set ::timings [dict create]
+
+    # run script in the caller, adding its run time to the given family and
+    # side (module or built-in) of the timings
+    proc timed {family side script} {
+        set start [clock microseconds]
+        set res [uplevel 1 $script]
+        dict incr ::timings [list $family $side] \
+            [expr {[clock microseconds] - $start}]
+        return $res
+    }
+
+    proc report_timings {} {
+        set families {}
+        dict for {key us} $::timings {
+            lappend families [lindex $key 0]
+        }
+        foreach family [lsort -unique $families] {
+            set module 0
+            set builtin 0
+            if {[dict exists $::timings [list $family module]]} {
+                set module [dict get $::timings [list $family module]]
+            }
+            if {[dict exists $::timings [list $family built-in]]} {
+                set builtin [dict get $::timings [list $family built-in]]
+            }
+            puts [format "    %-28s module %9.1f ms   built-in %9.1f ms" \
+                $family [expr {$module / 1000.0}] [expr {$builtin / 1000.0}]]
+        }
+    }
+
+    # few distinct scores so ties are common, and some infinities
+    proc random_score {} {
+        set r [randomInt 20]
+        if {$r == 0} { return -inf }
+        if {$r == 1} { return +inf }
+        return [expr {[randomInt 40] / 2.0 - 10}]
+    }
+
+    proc random_bound {} {
+        set r [randomInt 10]
+        if {$r == 0} {
+            set b -inf
+        } elseif {$r == 1} {
+            set b +inf
+        } else {
+            set b [expr {[randomInt 48] / 2.0 - 12}]
+        }
+        if {[randomInt 3] == 0} { set b "($b" }
+        return $b
+    }
+
+    proc random_suffix {} {
+        set suffix {}
+        if {[randomInt 2]} { lappend suffix WITHSCORES }
+        if {[randomInt 2]} {
+            lappend suffix LIMIT [lindex {-3 -1 0 0 1 3 10 1000000000} [randomInt 8]] \
+                [lindex {-1 -5 0 1 2 5 100} [randomInt 7]]
+        }
+        return $suffix
+    }
+
+    # members are drawn from m0 ... m<universe-1>
+    proc create_random_zset {key size universe} {
+        r del $key
+        for {set i 0} {$i < $size} {incr i} {
+            r zadd $key [random_score] "m[randomInt $universe]"
+        }
+    }
+
+    proc create_random_set {key size universe} {
+        r del $key
+        for {set i 0} {$i < $size} {incr i} {
+            r sadd $key [randomInt $universe]
+        }
+    }
+
+    proc in_window {score min max} {
+        set minex [string match "(*" $min]
+        set maxex [string match "(*" $max]
+        set min [string trimleft $min (]
+        set max [string trimleft $max (]
+        expr {($minex ? $score > $min : $score >= $min) &&
+              ($maxex ? $score < $max : $score <= $max)}
+    }
+
+    # store the intersection of key1 and key2 in difftmp, with the scores of
+    # key2 zeroed so the result keeps the scores of key1 (multiplying
+    # infinite scores by a zero weight would give NaN)
+    proc builtin_interstore {k1 k2} {
+        r zunionstore difftmp2 1 $k2 WEIGHTS 0
+        r zinterstore difftmp 2 $k1 difftmp2
+        r del difftmp2
+    }
+
+    # ZINTERRANGEBYSCORE as a range of the stored intersection
+    proc builtin_range {reverse min max suffix} {
+        if {$reverse} {
+            return [r zrevrangebyscore difftmp $max $min {*}$suffix]
+        }
+        return [r zrangebyscore difftmp $min $max {*}$suffix]
+    }
+
+    proc builtin_inter {k1 k2 reverse min max suffix} {
+        builtin_interstore $k1 $k2
+        set res [builtin_range $reverse $min $max $suffix]
+        r del difftmp
+        return $res
+    }
+
+    # members of key in [lo, hi] that are also in the range min max
+    proc bucket_count {key lo hi min max} {
+        set n 0
+        foreach {m s} [r zrangebyscore $key $lo $hi WITHSCORES] {
+            if {[in_window $s $min $max]} { incr n }
+        }
+        return $n
+    }
+
+    # check every row of ZINTERCARD.GROUPED against ZRANGEBYSCORE over
+    # [start, start+width) of the intersection of source with each filter,
+    # and that the rows cover all of the range of source
+    proc check_grouped {rows src filters min max width} {
+        set covered 0
+        set prev -inf
+        foreach row $rows {
+            set start [lindex $row 0]
+            assert {$start > $prev}
+            set prev $start
+            if {$width eq {}} {
+                set lo $min
+                set hi $max
+            } elseif {[string match -nocase "*inf" $start]} {
+                set lo $start
+                set hi $start
+            } else {
+                set lo $start
+                set hi "([expr {$start + $width}]"
+            }
+            set n [bucket_count $src $lo $hi $min $max]
+            assert {$n > 0}
+            incr covered $n
+            foreach filter $filters count [lrange $row 1 end] {
+                builtin_interstore $src $filter
+                assert_equal [bucket_count difftmp $lo $hi $min $max] $count
+                r del difftmp
+            }
+        }
+        if {$width eq {}} { assert {[llength $rows] <= 1} }
+        assert_equal [r zcount $src $min $max] $covered
+    }
+
+    # the range of key1, filtered by the score of its members in key2:
+    # members are kept when in key2 (within window if given) for an inter,
+    # or when not for a diff. The kept members are stored in a temporary key
+    # so that the suffix is applied by ZRANGEBYSCORE itself.
+    proc builtin_filtered {k1 k2 reverse isdiff min max suffix {window {}}} {
+        r del difftmp
+        foreach {m s} [r zrangebyscore $k1 $min $max WITHSCORES] {
+            set s2 [r zscore $k2 $m]
+            set found [expr {$s2 ne {}}]
+            if {$found && $window ne {}} {
+                set found [in_window $s2 {*}$window]
+            }
+            if {$found != $isdiff} { r zadd difftmp $s $m }
+        }
+        if {$reverse} {
+            set res [r zrevrangebyscore difftmp +inf -inf {*}$suffix]
+        } else {
+            set res [r zrangebyscore difftmp -inf +inf {*}$suffix]
+        }
+        r del difftmp
+        return $res
+    }
+
+    proc check_ranges {k1 k2 family} {
+        for {set i 0} {$i < $::diff_queries} {incr i} {
+            set min [random_bound]
+            set max [random_bound]
+            set suffix [random_suffix]
+
+            builtin_interstore $k1 $k2
+            set res [timed $family module {r zinterrangebyscore $k1 $k2 $min $max {*}$suffix}]
+            set exp [timed $family built-in {builtin_range 0 $min $max $suffix}]
+            assert_equal $exp $res
+
+            set res [timed $family module {r zinterrevrangebyscore $k1 $k2 $max $min {*}$suffix}]
+            set exp [timed $family built-in {builtin_range 1 $min $max $suffix}]
+            assert_equal $exp $res
+
+            # the same query prepared once and run by name
+            r fastsetops.prepare diffq zinterrevrangebyscore {*}$suffix
+            set res [timed "fastsetops.exec" module {r fastsetops.exec diffq $k1 $k2 $max $min}]
+            set exp [timed "fastsetops.exec" built-in {builtin_range 1 $min $max $suffix}]
+            assert_equal $exp $res
+            r del difftmp
+
+            set res [r zdiffrangebyscore $k1 $k2 $min $max {*}$suffix]
+            assert_equal [builtin_filtered $k1 $k2 0 1 $min $max $suffix] $res
+
+            set res [r zdiffrevrangebyscore $k1 $k2 $max $min {*}$suffix]
+            assert_equal [builtin_filtered $k1 $k2 1 1 $min $max $suffix] $res
+
+            set window [list [random_bound] [random_bound]]
+            set res [r zinterrangebyscore $k1 $k2 $min $max {*}$suffix INCLUDEIF {*}$window]
+            assert_equal [builtin_filtered $k1 $k2 0 0 $min $max $suffix $window] $res
+
+            set res [r zdiffrevrangebyscore $k1 $k2 $max $min EXCLUDEIF {*}$window {*}$suffix]
+            assert_equal [builtin_filtered $k1 $k2 1 1 $min $max $suffix $window] $res
+
+            r fastsetops.prepare diffq zdiffrangebyscore {*}$suffix EXCLUDEIF {*}$window
+            set res [r fastsetops.exec diffq $k1 $k2 $min $max]
+            assert_equal [builtin_filtered $k1 $k2 0 1 $min $max $suffix $window] $res
+        }
+        r fastsetops.drop diffq
+    }
+
+    foreach {encoding size} {ziplist 100 skiplist 1000} {
+        if {$encoding == "ziplist"} {
+            r config set zset-max-ziplist-entries 128
+        } else {
+            r config set zset-max-ziplist-entries 0
+        }
+
+        test "Differential ZINTER/ZDIFF ranges - $encoding" {
+            foreach universe [list [expr {$size / 2}] [expr {$size * 4}]] {
+                create_random_zset zk1 $size $universe
+                create_random_zset zk2 [randomInt [expr {$size * 2}]] $universe
+                assert_encoding $encoding zk1
+                check_ranges zk1 zk2 "zinterrangebyscore"
+                check_ranges zk2 zk1 "zinterrangebyscore"
+                check_ranges zk1 zk1 "zinterrangebyscore"
+            }
+        }
+
+        test "Differential ZINTER ranges with ZINTERINDEX - $encoding" {
+            create_random_zset zk1 $size $size
+            create_random_zset zk2 $size $size
+            foreach width {0.5 3 1000} {
+                r zinterindex.create zk1 zk2 $width
+                check_ranges zk1 zk2 "zinterrangebyscore+index"
+                # the index has to follow changes to both keys
+                for {set i 0} {$i < 50} {incr i} {
+                    r zadd zk[expr {1 + [randomInt 2]}] [random_score] "m[randomInt $size]"
+                    r zrem zk[expr {1 + [randomInt 2]}] "m[randomInt $size]"
+                }
+                check_ranges zk1 zk2 "zinterrangebyscore+index"
+                r zinterindex.drop zk1 zk2
+            }
+        }
+
+        test "Differential ZINTERVIEW - $encoding" {
+            create_random_zset zk1 $size $size
+            create_random_zset zk2 $size $size
+            r del zview
+            r zinterview.create zview zk1 zk2
+            for {set i 0} {$i < $::diff_queries} {incr i} {
+                set key zk[expr {1 + [randomInt 2]}]
+                switch [randomInt 4] {
+                    0 { r zadd $key [random_score] "m[randomInt $size]" }
+                    1 { r zincrby $key 1 "m[randomInt $size]" }
+                    2 { r zrem $key "m[randomInt $size]" }
+                    3 { r zremrangebyscore $key [random_bound] [random_bound] }
+                }
+                set min [random_bound]
+                set max [random_bound]
+                set suffix [random_suffix]
+                builtin_interstore zk1 zk2
+                set res [timed "zinterview" module {r zinterview.rangebyscore zview $min $max {*}$suffix}]
+                set exp [timed "zinterview" built-in {builtin_range 0 $min $max $suffix}]
+                assert_equal $exp $res
+                set res [timed "zinterview" module {r zinterview.revrangebyscore zview $max $min {*}$suffix}]
+                set exp [timed "zinterview" built-in {builtin_range 1 $min $max $suffix}]
+                assert_equal $exp $res
+                assert_equal [r zcard difftmp] [r zinterview.card zview]
+                r del difftmp
+            }
+        }
+
+        test "Differential ZINTERCARD.GROUPED and ZINTERRANDMEMBER - $encoding" {
+            create_random_zset zk1 $size $size
+            create_random_zset zk2 $size $size
+            create_random_zset zk3 $size [expr {$size * 4}]
+            for {set i 0} {$i < $::diff_queries / 10} {incr i} {
+                set min [expr {[randomInt 20] - 10}]
+                set max [random_bound]
+                set bucket [lindex {{} {BUCKET 0.5} {BUCKET 3}} [randomInt 3]]
+                set rows [r zintercard.grouped zk1 $min $max {*}$bucket FILTERS zk2 zk3]
+                check_grouped $rows zk1 {zk2 zk3} $min $max [lindex $bucket 1]
+
+                set count [randomInt 20]
+                set inter [builtin_inter zk1 zk2 0 -inf +inf WITHSCORES]
+                set res [r zinterrandmember zk1 zk2 $count WITHSCORES MAXATTEMPTS [randomInt 40]]
+                set expcount [expr {min($count, [llength $inter] / 2)}]
+                assert_equal [expr {$expcount * 2}] [llength $res]
+                foreach {m s} $res {
+                    assert_equal [dict get $inter $m] $s
+                }
+                assert_equal $expcount [llength [lsort -unique [dict keys $res]]]
+            }
+        }
+    }
+
+    foreach encoding {intset hashtable} {
+        if {$encoding == "intset"} {
+            r config set set-max-intset-entries 512
+        } else {
+            r config set set-max-intset-entries 0
+        }
+
+        test "Differential SINTERCARD/SDIFFCARD/SUNIONCARD - $encoding" {
+            for {set i 0} {$i < $::diff_queries / 10} {incr i} {
+                set keys {}
+                set numkeys [expr {1 + [randomInt 4]}]
+                for {set j 0} {$j < $numkeys} {incr j} {
+                    create_random_set sk$j [expr {1 + [randomInt 400]}] 500
+                    lappend keys sk$j
+                }
+                lappend keys nonset
+                assert_encoding $encoding sk0
+
+                foreach {cmd store} {sintercard sinterstore sdiffcard sdiffstore
+                                     sunioncard sunionstore} {
+                    set res [timed $cmd module {r $cmd {*}$keys}]
+                    set exp [timed $cmd built-in {r $store difftmp {*}$keys}]
+                    assert_equal $exp $res
+                }
+
+                set matrix [r sintercard.matrix {*}$keys]
+                set jaccard [r sjaccard.matrix {*}$keys]
+                for {set a 0} {$a < [llength $keys]} {incr a} {
+                    for {set b 0} {$b < [llength $keys]} {incr b} {
+                        set inter [r sinterstore difftmp [lindex $keys $a] [lindex $keys $b]]
+                        set union [r sunionstore difftmp [lindex $keys $a] [lindex $keys $b]]
+                        assert_equal $inter [lindex $matrix $a $b]
+                        set exp [expr {$union == 0 ? 0.0 : double($inter) / $union}]
+                        assert {abs([lindex $jaccard $a $b] - $exp) < 1e-12}
+                    }
+                }
+
+                set count [randomInt 20]
+                set inter [r sinter sk0 sk1]
+                set res [r sinterrandmember sk0 sk1 $count MAXATTEMPTS [randomInt 40]]
+                assert_equal [expr {min($count, [llength $inter])}] [llength $res]
+                assert_equal [llength $res] [llength [lsort -unique $res]]
+                foreach m $res {
+                    assert {[lsearch -exact $inter $m] != -1}
+                }
+            }
+            r del difftmp
+        }
+    }
+
+    test "Throughput of large ranges against built-in pipelines" {
+        set size $::diff_throughput_size
+        r config set zset-max-ziplist-entries 128
+        r config set set-max-intset-entries 512
+        create_random_zset zk1 $size $size
+        create_random_zset zk2 $size $size
+        create_random_set sk0 $size $size
+        create_random_set sk1 $size $size
+
+        builtin_interstore zk1 zk2
+        for {set i 0} {$i < 20} {incr i} {
+            set min [random_bound]
+            set max [random_bound]
+            set res [timed "large zinterrangebyscore" module {r zinterrangebyscore zk1 zk2 $min $max LIMIT 0 10}]
+            set exp [timed "large zinterrangebyscore" built-in {builtin_range 0 $min $max {LIMIT 0 10}}]
+            assert_equal $exp $res
+
+            set res [timed "large sunioncard" module {r sunioncard sk0 sk1}]
+            set exp [timed "large sunioncard" built-in {r sunionstore difftmp2 sk0 sk1}]
+            assert_equal $exp $res
+        }
+        r del difftmp difftmp2
+    }
+
+    puts "    Timings (module vs built-in equivalent):"
+    report_timings
+}
@@ -160,6 +160,49 @@ start_server $options {
             assert_error "*WRONGTYPE*" {r sunioncard set l otherset}
             assert_error "*WRONGTYPE*" {r sunioncard l set otherset}
         }
+        test "SINTERCARD.MATRIX/SJACCARD.MATRIX" {
+            create_default_set
+            create_default_otherset
+            r del third
+            r sadd third c z
+
+            assert_equal {{7 3 1} {3 4 0} {1 0 2}} [r sintercard.matrix set otherset third]
+            assert_equal {{4 3} {3 7}} [r sintercard.matrix otherset set]
+            assert_equal {{7 7} {7 7}} [r sintercard.matrix set set]
+            assert_equal {{7 0} {0 0}} [r sintercard.matrix set nonset]
+            assert_equal {{1 0.375 0.125} {0.375 1 0} {0.125 0 1}} [r sjaccard.matrix set otherset third]
+            assert_equal {{0}} [r sjaccard.matrix nonset]
+
+            create_nonsets
+            assert_error "*WRONGTYPE*" {r sintercard.matrix set t}
+            assert_error "*WRONGTYPE*" {r sjaccard.matrix h set}
+
+            assert_error "*too many keys*" {r sintercard.matrix {*}[lrepeat 1025 set]}
+            assert_error "*too many keys*" {r sjaccard.matrix {*}[lrepeat 1025 set]}
+        }
+
+        test "SINTERRANDMEMBER" {
+            r del s1 s2
+            for {set i 1} {$i <= 10} {incr i} { r sadd s1 $i }
+            for {set i 5} {$i <= 20} {incr i} { r sadd s2 $i }
+
+            set res [r sinterrandmember s1 s2 3]
+            assert_equal 3 [llength $res]
+            assert_equal 3 [llength [lsort -unique $res]]
+            foreach m $res {
+                assert {$m >= 5 && $m <= 10}
+            }
+            assert_equal {5 6 7 8 9 10} [lsort -integer [r sinterrandmember s2 s1 100]]
+            assert_equal 4 [llength [r sinterrandmember s1 s2 4 MAXATTEMPTS 0]]
+            assert_equal {5 6 7 8 9 10} [lsort -integer [r sinterrandmember s1 s2 6 MAXATTEMPTS 1]]
+            assert_equal {} [r sinterrandmember s1 nonset 3]
+            assert_equal {} [r sinterrandmember s1 s2 0]
+
+            create_nonsets
+            assert_error "*WRONGTYPE*" {r sinterrandmember s1 t 1}
+            assert_error "*non negative*" {r sinterrandmember s1 s2 -1}
+            assert_error "*wrong number*" {r sinterrandmember s1 s2 1 WITHSCORES}
+        }
     }
 
     runs intset
@@ -280,6 +323,9 @@ start_server $options {
             assert_equal {d c b} [r zinterrevrangebyscore zset interset 10 0 LIMIT 2 10]
             assert_equal {d c b} [r zinterrevrangebyscore zset interset +inf 0 LIMIT 2 10]
             assert_equal {}      [r zinterrevrangebyscore zset interset 10 0 LIMIT 20 10]
+            assert_equal {d e f} [r zinterrangebyscore zset interset 0 10 LIMIT 2 -5]
+            assert_equal {}      [r zinterrangebyscore zset interset 0 10 LIMIT -1 10]
+            assert_equal {}      [r zdiffrevrangebyscore zset diffset 10 0 LIMIT -3 -1]
         }
 
         test "ZINTERRANGEBYSCORE with LIMIT and WITHSCORES" {
@@ -384,8 +430,426 @@ start_server $options {
             assert_error "*not*float*" {r zdiffrangebyscore fooz barz 1 str}
             assert_error "*not*float*" {r zdiffrangebyscore fooz barz 1 NaN}
         }
+
+        test "ZINTERRANGEBYSCORE with INCLUDEIF" {
+            create_default_zset
+            create_default_interset
+            assert_equal {d e f} [r zinterrangebyscore zset interset -inf +inf INCLUDEIF 0 +inf]
+            assert_equal {b c} [r zinterrangebyscore zset interset -inf +inf INCLUDEIF -inf (3]
+            assert_equal {d 3} [r zinterrangebyscore zset interset -inf +inf INCLUDEIF 3 3 WITHSCORES]
+            assert_equal {e} [r zinterrangebyscore zset interset -inf +inf INCLUDEIF 3 +inf LIMIT 1 1]
+            assert_equal {f e d} [r zinterrevrangebyscore zset interset +inf -inf INCLUDEIF 3 +inf]
+            assert_equal {} [r zinterrangebyscore zset interset -inf +inf INCLUDEIF 1 2]
+        }
+
+        test "ZDIFFRANGEBYSCORE with EXCLUDEIF" {
+            create_default_zset
+            create_default_diffset
+            assert_equal {a b c d f} [r zdiffrangebyscore zset diffset -inf +inf EXCLUDEIF 3 4]
+            assert_equal {b d e f g} [r zdiffrangebyscore zset diffset -inf +inf EXCLUDEIF -inf -inf]
+            assert_equal {a b c d e f} [r zdiffrangebyscore zset diffset -inf +inf EXCLUDEIF (3 4 LIMIT 0 -1]
+            assert_equal {f e d c b a} [r zdiffrevrangebyscore zset diffset 5 -inf EXCLUDEIF 4 +inf]
+            assert_equal {b 1 c 2 d 3} [r zdiffrangebyscore zset nonset 1 3 WITHSCORES EXCLUDEIF -inf +inf LIMIT 0 3]
+            assert_equal {b 1 d 3} [r zdiffrangebyscore zset diffset 1 3 WITHSCORES EXCLUDEIF -inf +inf]
+        }
+
+        test "INCLUDEIF/EXCLUDEIF errors" {
+            assert_error "*EXCLUDEIF*" {r zinterrangebyscore zset interset -inf +inf EXCLUDEIF 0 1}
+            assert_error "*INCLUDEIF*" {r zdiffrangebyscore zset diffset -inf +inf INCLUDEIF 0 1}
+            assert_error "*not*float*" {r zinterrangebyscore zset interset -inf +inf INCLUDEIF str 1}
+            assert_error "*wrong number*" {r zinterrangebyscore zset interset -inf +inf INCLUDEIF 0}
+        }
+
+        # the counts of the first filter in each row of ZINTERCARD.GROUPED
+        proc grouped_counts {rows} {
+            set counts {}
+            foreach row $rows {lappend counts [lindex $row 1]}
+            return $counts
+        }
+
+        test "ZINTERCARD.GROUPED" {
+            create_default_zset
+            create_default_interset
+            create_default_diffset
+
+            assert_equal {{-inf 5 4}} [r zintercard.grouped zset -inf +inf FILTERS interset diffset]
+            assert_equal {{1 2 1 0} {3 2 1 0} {5 1 0 0}} [r zintercard.grouped zset 1 5 BUCKET 2 FILTERS interset diffset nonset]
+            assert_equal {{1 1 1} {3 2 1} {5 1 0}} [r zintercard.grouped zset (1 5 BUCKET 2 FILTERS interset diffset]
+            assert_equal {{0 1} {1.5 1} {3 1}} [r zintercard.grouped zset 0 3 BUCKET 1.5 FILTERS zset]
+            assert_equal {} [r zintercard.grouped nonset 0 3 FILTERS zset]
+
+            # scores on bucket edges that decimal widths can't hit exactly
+            r del edges edgefilter
+            r zadd edges 0.1 a 0.2 b 0.3 c 0.5 d 0.7 e 1.1 f
+            r zadd edgefilter 0 c 0 e 0 f
+            assert_equal {0 0 1 0 1 1} [grouped_counts [r zintercard.grouped edges 0.1 +inf BUCKET 0.1 FILTERS edgefilter]]
+            assert_equal {0 1 0 1 1} [grouped_counts [r zintercard.grouped edges 0.1 +inf BUCKET 0.2 FILTERS edgefilter]]
+            assert_equal {} [r zintercard.grouped zset 3 0 FILTERS zset]
+
+            create_nonsets
+            assert_error "*WRONGTYPE*" {r zintercard.grouped zset 0 1 FILTERS interset t}
+            assert_error "*WRONGTYPE*" {r zintercard.grouped h 0 1 FILTERS interset}
+            assert_error "*finite min*" {r zintercard.grouped zset -inf 1 BUCKET 1 FILTERS interset}
+            assert_error "*width*" {r zintercard.grouped zset 0 1 BUCKET 0 FILTERS interset}
+            assert_error "*not*float*" {r zintercard.grouped zset x 1 FILTERS interset}
+            assert_error "*wrong number*" {r zintercard.grouped zset 0 1 interset}
+            assert_error "*wrong number*" {r zintercard.grouped zset 0 1 BUCKET 1 FILTERS}
+            assert_equal {zset interset diffset} [r command getkeys zintercard.grouped zset 0 1 BUCKET 1 FILTERS interset diffset]
+            assert_equal {zset interset} [r command getkeys zintercard.grouped zset 0 1 FILTERS interset]
+        }
+
+        test "FASTSETOPS.PREPARE/FASTSETOPS.EXEC" {
+            create_default_zset
+            create_default_interset
+            create_default_diffset
+
+            assert_equal OK [r fastsetops.prepare top2 zinterrevrangebyscore WITHSCORES LIMIT 0 2]
+            assert_equal {f 5 e 4} [r fastsetops.exec top2 zset interset +inf -inf]
+            assert_equal {d 3 c 2} [r fastsetops.exec top2 zset interset 3 -inf]
+            assert_equal {} [r fastsetops.exec top2 zset nonset +inf -inf]
+
+            assert_equal OK [r fastsetops.prepare unseen ZDIFFRANGEBYSCORE EXCLUDEIF 3 4]
+            assert_equal {a b c d f} [r fastsetops.exec unseen zset diffset -inf +inf]
+
+            # preparing again replaces the query
+            assert_equal OK [r fastsetops.prepare top2 zinterrangebyscore LIMIT 1 2]
+            assert_equal {c d} [r fastsetops.exec top2 zset interset -inf +inf]
+
+            assert_equal 1 [r fastsetops.drop top2]
+            assert_equal 0 [r fastsetops.drop top2]
+            assert_error "*no such prepared query*" {r fastsetops.exec top2 zset interset -inf +inf}
+        }
+
+        test "FASTSETOPS.PREPARE errors" {
+            assert_error "*can't be prepared*" {r fastsetops.prepare q zrangebyscore}
+            assert_error "*EXCLUDEIF*" {r fastsetops.prepare q zinterrangebyscore EXCLUDEIF 0 1}
+            assert_error "*offset*" {r fastsetops.prepare q zinterrangebyscore LIMIT x 1}
+            assert_error "*wrong number*" {r fastsetops.prepare q}
+            r fastsetops.prepare q zinterrangebyscore
+            assert_error "*not*float*" {r fastsetops.exec q zset interset str 1}
+            assert_error "*wrong number*" {r fastsetops.exec q zset interset 1}
+            create_nonsets
+            assert_error "*WRONGTYPE*" {r fastsetops.exec q zset t 0 1}
+        }
+
+        test "ZINTERRANGEBYSCORE.CLUSTER/ZDIFFRANGEBYSCORE.CLUSTER outside of a cluster" {
+            create_default_zset
+            create_default_interset
+            create_default_diffset
+            assert_equal {b c d} [r zinterrangebyscore.cluster zset interset 0 3]
+            assert_equal {f e} [r zinterrevrangebyscore.cluster zset interset 10 0 LIMIT 0 2]
+            assert_equal {b 1 d 3} [r zdiffrangebyscore.cluster zset diffset 0 3 withscores]
+            assert_equal {d b} [r zdiffrevrangebyscore.cluster zset diffset 3 0]
+            assert_equal {} [r zinterrangebyscore.cluster zset nonset -inf +inf]
+            assert_error "*not*float*" {r zinterrangebyscore.cluster zset interset str 1}
+            assert_equal {zset interset} [r command getkeys zinterrangebyscore.cluster zset interset 0 3]
+        }
+
+        test "ZINTERRANGEBYSCORE with ZINTERINDEX" {
+            create_default_zset
+            create_default_interset
+            r zinterindex.drop zset interset
+            assert_equal OK [r zinterindex.create zset interset 2]
+
+            assert_equal {b c} [r zinterrangebyscore zset interset -inf 2]
+            assert_equal {b c d} [r zinterrangebyscore zset interset 0 3]
+            assert_equal {e f} [r zinterrangebyscore zset interset (3 (6]
+            assert_equal {f} [r zinterrangebyscore zset interset (4 +inf]
+            assert_equal {c b} [r zinterrevrangebyscore zset interset (3 (0]
+            assert_equal {f e d} [r zinterrevrangebyscore zset interset 6 3]
+            assert_equal {d e f} [r zinterrangebyscore zset interset 0 10 LIMIT 2 10]
+            assert_equal {d 3 c 2} [r zinterrevrangebyscore zset interset 5 2 LIMIT 2 3 WITHSCORES]
+            assert_equal {} [r zinterrangebyscore zset interset 2.4 2.6]
+
+            # follows changes to either key
+            r zadd interset 0 a 0 g
+            assert_equal {a b} [r zinterrangebyscore zset interset -inf 1]
+            assert_equal {g f} [r zinterrevrangebyscore zset interset +inf 5]
+            r zadd zset 100 c
+            r zrem interset d
+            assert_equal {b e f c} [r zinterrangebyscore zset interset 0 100]
+            r del interset
+            assert_equal {} [r zinterrangebyscore zset interset -inf +inf]
+            create_default_interset
+            assert_equal {b d e f c} [r zinterrangebyscore zset interset -inf +inf]
+
+            assert_equal 1 [r zinterindex.drop zset interset]
+            assert_equal 0 [r zinterindex.drop zset interset]
+            assert_error "*width*" {r zinterindex.create zset interset 0}
+            assert_error "*width*" {r zinterindex.create zset interset inf}
+        }
+
+        test "ZINTERINDEX after a reload and on a replica" {
+            create_default_zset
+            create_default_interset
+            r zinterindex.create zset interset 2
+            r debug reload
+            assert_equal {b c d e f} [r zinterrangebyscore zset interset -inf +inf]
+
+            # the master is never reached, so the data stays
+            r replicaof 127.0.0.1 1
+            assert_error "*replica*" {r zinterindex.create zset diffset 2}
+            assert_equal {b c d} [r zinterrangebyscore zset interset 0 3]
+            r replicaof no one
+            r zadd interset 2.5 z
+            r zadd zset 2.5 z
+            assert_equal {b c z d} [r zinterrangebyscore zset interset 0 3]
+            assert_equal 1 [r zinterindex.drop zset interset]
+        }
+
+        test "ZINTERRANDMEMBER" {
+            create_default_zset
+            create_default_interset
+
+            set res [r zinterrandmember zset interset 2 WITHSCORES]
+            assert_equal 4 [llength $res]
+            foreach {m score} $res {
+                assert_equal [r zscore zset $m] $score
+                assert {[lsearch {b c d e f} $m] != -1}
+            }
+            assert_equal {b c d e f} [lsort [r zinterrandmember zset interset 10]]
+            assert_equal {b c d e f} [lsort [r zinterrandmember interset zset 5 MAXATTEMPTS 0]]
+            assert_equal 3 [llength [lsort -unique [r zinterrandmember zset interset 3 MAXATTEMPTS 1]]]
+            assert_equal {} [r zinterrandmember zset nonset 3]
+
+            # a sparse intersection, sampled or scanned depending on count
+            r del big1 big2
+            for {set i 0} {$i < 1000} {incr i} {
+                r zadd big1 $i m$i
+                if {$i % 100 == 0} {r zadd big2 $i m$i}
+            }
+            r zadd big2 -1 x -2 y
+            assert_equal 10 [llength [lsort -unique [r zinterrandmember big1 big2 10]]]
+            assert_equal 3 [llength [lsort -unique [r zinterrandmember big1 big2 3]]]
+            assert_equal 1 [llength [r zinterrandmember big2 big1 1]]
+
+            create_nonsets
+            assert_error "*WRONGTYPE*" {r zinterrandmember zset t 1}
+            assert_error "*non negative*" {r zinterrandmember zset interset x}
+            assert_error "*non negative*" {r zinterrandmember zset interset 1 MAXATTEMPTS -1}
+        }
+
+        test "ZINTERVIEW basics" {
+            create_default_zset
+            create_default_interset
+            r del view
+
+            assert_equal OK [r zinterview.create view zset interset]
+            assert_equal 5 [r zinterview.card view]
+            assert_equal {b c d e f} [r zinterview.rangebyscore view -inf +inf]
+            assert_equal {b c d} [r zinterview.rangebyscore view 0 3]
+            assert_equal {c d} [r zinterview.rangebyscore view (1 3]
+            assert_equal {f e} [r zinterview.revrangebyscore view +inf 4]
+            assert_equal {e d} [r zinterview.revrangebyscore view (5 3]
+            assert_equal {b 1 c 2 d 3} [r zinterview.rangebyscore view 0 3 withscores]
+            assert_equal {d e f} [r zinterview.rangebyscore view 0 10 LIMIT 2 10]
+            assert_equal {} [r zinterview.rangebyscore view 0 10 LIMIT -1 10]
+            assert_equal {e f} [r zinterview.rangebyscore view 4 10 LIMIT 0 -1]
+            assert_equal {d 3 c 2} [r zinterview.revrangebyscore view 5 2 LIMIT 2 3 WITHSCORES]
+            assert_equal {} [r zinterview.rangebyscore view 4 2]
+            assert_equal {} [r zinterview.rangebyscore nonview 0 3]
+            assert_equal 0 [r zinterview.card nonview]
+        }
+
+        test "ZINTERVIEW follows member changes" {
+            create_default_zset
+            create_default_interset
+            r del view
+            r zinterview.create view zset interset
+
+            r zadd interset 0 a
+            assert_equal {a b c} [r zinterview.rangebyscore view -inf 2]
+            r zrem zset b
+            assert_equal {a c} [r zinterview.rangebyscore view -inf 2]
+            r zadd zset 10 c
+            assert_equal {d e f c} [r zinterview.rangebyscore view 0 +inf]
+            r zincrby zset -8 c
+            assert_equal {c 2 d 3} [r zinterview.rangebyscore view 0 3 withscores]
+            r zadd zset xx ch 7 d
+            assert_equal {e f d} [r zinterview.rangebyscore view 4 10]
+            r multi
+            r zrem interset e
+            r zadd zset 20 z
+            r zadd interset 20 z
+            r exec
+            assert_equal {f d z} [r zinterview.rangebyscore view 4 +inf]
+        }
+
+        test "ZINTERVIEW follows whole key changes" {
+            create_default_zset
+            create_default_interset
+            r del view
+            r zinterview.create view zset interset
+
+            r zremrangebyscore zset 2 4
+            assert_equal {b f} [r zinterview.rangebyscore view -inf +inf]
+            r del interset
+            assert_equal {} [r zinterview.rangebyscore view -inf +inf]
+            create_default_interset
+            assert_equal {b f} [r zinterview.rangebyscore view -inf +inf]
+            r rename interset otherset
+            assert_equal 0 [r zinterview.card view]
+        }
+
+        test "ZINTERVIEW after commands that change nothing" {
+            create_default_zset
+            create_default_interset
+            r del view
+            r zinterview.create view zset interset
+
+            r zadd interset 0 geo
+            r zadd zset 1 b
+            r zadd zset nx 9 c
+            r zrem zset nonmember
+            r geoadd zset 0 0 geo
+            assert_equal 6 [r zinterview.card view]
+            r zrem interset nonmember
+            r zadd interset 0 a
+            assert_equal {a b c} [r zinterview.rangebyscore view -inf 2]
+            r expire interset 100
+            r persist interset
+            r zadd interset 0 z
+            r zadd zset 0 z
+            assert_equal {z b c} [r zinterview.rangebyscore view 0 2]
+        }
+
+        test "ZINTERVIEW freed asynchronously" {
+            create_default_zset
+            create_default_interset
+            r zinterview.create view zset interset
+            r zinterview.create view2 interset zset
+            r flushall async
+            create_default_zset
+            create_default_interset
+            r zadd zset 10 c
+            r zinterview.create view zset interset
+            assert_equal {d e f c} [r zinterview.rangebyscore view 0 +inf]
+            r zrem interset d
+            assert_equal {e f c} [r zinterview.rangebyscore view 0 +inf]
+            assert_equal 0 [r exists view2]
+        }
+
+        test "ZINTERVIEW with non-zset" {
+            create_default_zset
+            create_nonsets
+            assert_error "*WRONGTYPE*" {r zinterview.create zset zset t}
+            assert_error "*WRONGTYPE*" {r zinterview.create view zset h}
+            assert_error "*WRONGTYPE*" {r zinterview.rangebyscore zset 0 1}
+            assert_error "*not*float*" {r zinterview.rangebyscore view str 1}
+        }
+
+        test "ZINTERVIEW is persisted" {
+            create_default_zset
+            create_default_interset
+            r del view
+            r zinterview.create view zset interset
+            r debug reload
+            assert_equal {b c d e f} [r zinterview.rangebyscore view -inf +inf]
+            r zrem interset c
+            assert_equal {b d} [r zinterview.rangebyscore view -inf 3]
+        }
     }
 
     runz ziplist
     runz skiplist
 }
+
+# A cluster of two masters splitting the slots in half, so that the source
+# and filter keys of the .CLUSTER commands can be placed on different nodes.
+# Cluster mode has no SELECT, so the servers are used with their single db.
+set clusteroptions [list loadmodule "${moduleLocation}/../src/redis-fast-set-ops.so cluster-digest-max-members 100" cluster-enabled yes]
+dict set options overrides $clusteroptions
+set singledb $::singledb
+set ::singledb 1
+start_server $options {
+start_server $options {
+    # find a key starting with prefix that hashes to a slot in first..last
+    proc key_in_slots {prefix first last} {
+        for {set i 0} {1} {incr i} {
+            set slot [r cluster keyslot "$prefix$i"]
+            if {$slot >= $first && $slot <= $last} {return "$prefix$i"}
+        }
+    }
+
+    test "Create a two node cluster" {
+        set slots {}
+        for {set i 0} {$i < 8192} {incr i} {lappend slots $i}
+        r cluster addslots {*}$slots
+        set slots {}
+        for {set i 8192} {$i < 16384} {incr i} {lappend slots $i}
+        r -1 cluster addslots {*}$slots
+        r cluster meet 127.0.0.1 [srv -1 port]
+        wait_for_condition 100 100 {
+            [string match {*cluster_state:ok*} [r cluster info]] &&
+            [string match {*cluster_state:ok*} [r -1 cluster info]]
+        } else {
+            fail "the cluster didn't come up"
+        }
+    }
+
+    set src [key_in_slots src 0 8191]
+    set filter [key_in_slots filter 8192 16383]
+    set missing [key_in_slots missing 8192 16383]
+    set big [key_in_slots big 8192 16383]
+
+    test "ZINTERRANGEBYSCORE.CLUSTER/ZDIFFRANGEBYSCORE.CLUSTER with a remote key" {
+        r zadd $src 1 a 2 b 3 c 4 d 5 e
+        r -1 zadd $filter 0 b 0 d 0 x
+        assert_equal {b d} [r zinterrangebyscore.cluster $src $filter -inf +inf]
+        assert_equal {d 4 b 2} [r zinterrevrangebyscore.cluster $src $filter +inf -inf WITHSCORES]
+        assert_equal {a c e} [r zdiffrangebyscore.cluster $src $filter -inf +inf]
+        assert_equal {c e} [r zdiffrangebyscore.cluster $src $filter -inf +inf LIMIT 1 5]
+        assert_equal {e c} [r zdiffrevrangebyscore.cluster $src $filter 5 2]
+    }
+
+    test "ZINTERRANGEBYSCORE.CLUSTER sees changes to the remote key" {
+        r -1 zadd $filter 0 e
+        r -1 zrem $filter b
+        assert_equal {d e} [r zinterrangebyscore.cluster $src $filter -inf +inf]
+        r -1 del $filter
+        assert_equal {} [r zinterrangebyscore.cluster $src $filter -inf +inf]
+        r -1 zadd $filter 0 a
+        assert_equal {b c d e} [r zdiffrangebyscore.cluster $src $filter -inf +inf]
+    }
+
+    test "ZINTERRANGEBYSCORE.CLUSTER when no master has the key" {
+        assert_equal {} [r zinterrangebyscore.cluster $src $missing -inf +inf]
+        assert_equal {a b c d e} [r zdiffrangebyscore.cluster $src $missing -inf +inf]
+    }
+
+    test "ZINTERRANGEBYSCORE.CLUSTER errors with a remote key" {
+        r -1 set $missing str
+        assert_error "*WRONGTYPE*" {r zinterrangebyscore.cluster $src $missing -inf +inf}
+        r -1 del $missing
+        for {set i 0} {$i < 101} {incr i} {r -1 zadd $big $i m$i}
+        assert_error "*too large*" {r zinterrangebyscore.cluster $src $big -inf +inf}
+        assert_error "*INCLUDEIF*" {r zinterrangebyscore.cluster $src $filter -inf +inf INCLUDEIF 0 1}
+        r multi
+        r zinterrangebyscore.cluster $src $filter -inf +inf
+        assert_error "*MULTI*" {r exec}
+    }
+
+    test "ZINTERRANGEBYSCORE.CLUSTER checks ACL rules for key2" {
+        assert_equal $src [r command getkeys zinterrangebyscore.cluster $src $filter -inf +inf]
+        if {![catch {r acl whoami}]} {
+            r acl setuser srconly on nopass ~src* +@all
+            r auth srconly any
+            # the remote path and the local fall-through alike
+            assert_error "*filter key*" {r zinterrangebyscore.cluster $src $filter -inf +inf}
+            assert_error "*filter key*" {r zinterrangebyscore.cluster $src src-local -inf +inf}
+            r auth default any
+            r acl deluser srconly
+        }
+    }
+
+    test "ZINTERRANGEBYSCORE.CLUSTER times out on a master that doesn't answer" {
+        set rd [redis_deferring_client -1]
+        $rd debug sleep 2
+        after 100
+        assert_error "*timed out*" {r zinterrangebyscore.cluster $src $missing -inf +inf}
+        $rd read
+        $rd close
+    }
+}
+}
+set ::singledb $singledb